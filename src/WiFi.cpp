@@ -19,6 +19,7 @@
 */
 
 #include "utility/wifi_drv.h"
+#include "utility/server_drv.h"
 #include "WiFi.h"
 
 extern "C" {
@@ -27,8 +28,22 @@ extern "C" {
   #include "utility/debug.h"
 }
 
-WiFiClass::WiFiClass() : _timeout(50000)
+enum {
+	RECONNECT_IDLE,
+	RECONNECT_WAITING,
+	RECONNECT_CONNECTING
+};
+
+WiFiClass::WiFiClass() : _timeout(50000), _scanning(false), _scanResult(WIFI_SCAN_FAILED),
+    _scanStart(0), _scanLastPoll(0), _scanCallback(NULL),
+    _fastReconnect(false), _lastNetworkValid(false), _lastChannel(0),
+    _pmkCache(false), _pmkValid(false),
+    _connecting(false), _connectStatus(WL_IDLE_STATUS), _connectStart(0), _connectLastPoll(0),
+    _connectTimeout(0), _statusCallback(NULL),
+    _autoReconnect(false), _linkUp(false), _reconnectState(RECONNECT_IDLE), _reconnectCheck(0),
+    _reconnectStart(0), _reconnectWait(0), _reconnectDelay(0), _reconnectSeeded(false), _outageStart(0), _reconnectCallback(NULL)
 {
+    _reconnectSsid[0] = 0;
 }
 
 void WiFiClass::init()
@@ -43,65 +58,399 @@ const char* WiFiClass::firmwareVersion()
 
 int WiFiClass::begin(const char* ssid)
 {
-	uint8_t status = WL_IDLE_STATUS;
-
-   if (WiFiDrv::wifiSetNetwork(ssid, strlen(ssid)) != WL_FAILURE)
-   {
-	   for (unsigned long start = millis(); (millis() - start) < _timeout;)
-	   {
-		   delay(WL_DELAY_START_CONNECTION);
-		   status = WiFiDrv::getConnectionStatus();
-		   if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-		     break;
-		   }
-	   }
-   }else
-   {
-	   status = WL_CONNECT_FAILED;
-   }
-   return status;
+	uint8_t status;
+
+	saveCredentials(ssid, NULL);
+
+	if (beginFast(ssid, NULL))
+		return WL_CONNECTED;
+
+	status = startConnection(WiFiDrv::wifiSetNetwork(ssid, strlen(ssid)), WL_CONNECT_FAILED, _timeout);
+	if (status != WL_CONNECT_FAILED)
+	{
+		status = waitConnection();
+		rememberNetwork(ssid, status);
+	}
+	return status;
 }
 
 int WiFiClass::begin(const char* ssid, uint8_t key_idx, const char *key)
 {
-	uint8_t status = WL_IDLE_STATUS;
+	if (beginAsync(ssid, key_idx, key) == WL_CONNECT_FAILED)
+		return WL_CONNECT_FAILED;
+	return waitConnection();
+}
+
+int WiFiClass::begin(const char* ssid, const char *passphrase)
+{
+	uint8_t status;
+	char pmkHex[WL_PMK_LENGTH * 2 + 1];
+
+	passphrase = cachedPassphrase(ssid, passphrase, pmkHex);
+	saveCredentials(ssid, passphrase);
+
+	if (beginFast(ssid, passphrase))
+		return WL_CONNECTED;
+
+	// set passphrase
+	status = startConnection(WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase)), WL_CONNECT_FAILED, _timeout);
+	if (status != WL_CONNECT_FAILED)
+	{
+		status = waitConnection();
+		rememberNetwork(ssid, status);
+	}
+	return status;
+}
+
+int WiFiClass::beginAsync(const char* ssid)
+{
+	saveCredentials(ssid, NULL);
+	return startConnection(WiFiDrv::wifiSetNetwork(ssid, strlen(ssid)), WL_CONNECT_FAILED, _timeout);
+}
+
+int WiFiClass::beginAsync(const char* ssid, uint8_t key_idx, const char *key)
+{
+	clearCredentials();
 
 	// set encryption key
-   if (WiFiDrv::wifiSetKey(ssid, strlen(ssid), key_idx, key, strlen(key)) != WL_FAILURE)
-   {
-	   for (unsigned long start = millis(); (millis() - start) < _timeout;)
-	   {
-		   delay(WL_DELAY_START_CONNECTION);
-		   status = WiFiDrv::getConnectionStatus();
-		   if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-		     break;
-		   }
-	   }
-   }else{
-	   status = WL_CONNECT_FAILED;
-   }
-   return status;
+	return startConnection(WiFiDrv::wifiSetKey(ssid, strlen(ssid), key_idx, key, strlen(key)), WL_CONNECT_FAILED, _timeout);
 }
 
-int WiFiClass::begin(const char* ssid, const char *passphrase)
+int WiFiClass::beginAsync(const char* ssid, const char *passphrase)
+{
+	char pmkHex[WL_PMK_LENGTH * 2 + 1];
+
+	// only use a key derived before, deriving it takes seconds
+	passphrase = cachedPassphrase(ssid, passphrase, pmkHex, false);
+	saveCredentials(ssid, passphrase);
+
+	// set passphrase
+	return startConnection(WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase)), WL_CONNECT_FAILED, _timeout);
+}
+
+const char* WiFiClass::cachedPassphrase(const char* ssid, const char* passphrase, char* pmkHex, bool derive)
+{
+	size_t len = strlen(passphrase);
+
+	// a 64 hex digits passphrase is already a key
+	if (!_pmkCache || len < WL_WPA_KEY_MIN_LENGTH || len > WL_WPA_KEY_MAX_LENGTH)
+		return passphrase;
+
+	if (!_pmkValid || strcmp(ssid, _pmkSsid) != 0 || strcmp(passphrase, _pmkPassphrase) != 0)
+	{
+		_pmkValid = false;
+		if (!derive || !derivePMK(ssid, passphrase, _pmk))
+			return passphrase;
+
+		strncpy(_pmkSsid, ssid, WL_SSID_MAX_LENGTH);
+		_pmkSsid[WL_SSID_MAX_LENGTH] = 0;
+		strcpy(_pmkPassphrase, passphrase);
+		_pmkValid = true;
+	}
+
+	pmkToHex(_pmk, pmkHex);
+	return pmkHex;
+}
+
+int WiFiClass::beginPMK(const char* ssid, const uint8_t* pmk)
+{
+	char pmkHex[WL_PMK_LENGTH * 2 + 1];
+
+	// the module takes the key as a 64 hex digits passphrase
+	pmkToHex(pmk, pmkHex);
+	return begin(ssid, pmkHex);
+}
+
+int WiFiClass::derivePMK(const char* ssid, const char* passphrase, uint8_t* pmk)
 {
-	uint8_t status = WL_IDLE_STATUS;
-
-    // set passphrase
-    if (WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase))!= WL_FAILURE)
-    {
-	   for (unsigned long start = millis(); (millis() - start) < _timeout;)
- 	   {
- 		   delay(WL_DELAY_START_CONNECTION);
- 		   status = WiFiDrv::getConnectionStatus();
-		   if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-		     break;
-		   }
- 	   }
-    }else{
-    	status = WL_CONNECT_FAILED;
-    }
-    return status;
+	size_t ssid_len = strlen(ssid);
+	size_t len = strlen(passphrase);
+
+	if (ssid_len == 0 || ssid_len > WL_SSID_MAX_LENGTH ||
+	    len < WL_WPA_KEY_MIN_LENGTH || len > WL_WPA_KEY_MAX_LENGTH)
+		return 0;
+
+	if (WiFiDrv::getPmk(ssid, ssid_len, passphrase, len, pmk) != WL_SUCCESS)
+		wifiDerivePmk(ssid, ssid_len, passphrase, len, pmk);
+	return 1;
+}
+
+void WiFiClass::setPMKCache(bool enable)
+{
+	_pmkCache = enable;
+	_pmkValid = false;
+}
+
+void WiFiClass::pmkToHex(const uint8_t* pmk, char* hex)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	for (uint8_t i = 0; i < WL_PMK_LENGTH; i++)
+	{
+		hex[i * 2] = digits[pmk[i] >> 4];
+		hex[i * 2 + 1] = digits[pmk[i] & 0x0f];
+	}
+	hex[WL_PMK_LENGTH * 2] = 0;
+}
+
+int WiFiClass::begin(const char* ssid, const char* passphrase, const uint8_t* bssid, uint8_t channel)
+{
+	saveCredentials(ssid, passphrase);
+	return beginBssid(ssid, passphrase, bssid, channel, _timeout);
+}
+
+int WiFiClass::beginBssid(const char* ssid, const char* passphrase, const uint8_t* bssid, uint8_t channel, unsigned long timeout)
+{
+	uint8_t len = (passphrase != NULL) ? strlen(passphrase) : 0;
+
+	if (startConnection(WiFiDrv::wifiSetPassphraseBssid(ssid, strlen(ssid), passphrase, len, bssid, channel), WL_CONNECT_FAILED, timeout) == WL_CONNECT_FAILED)
+		return WL_CONNECT_FAILED;
+
+	return waitConnection();
+}
+
+uint8_t WiFiClass::startConnection(int8_t result, uint8_t failStatus, unsigned long timeout)
+{
+	_connecting = false;
+
+	if (result == WL_FAILURE)
+	{
+		setConnectionStatus(failStatus);
+		return failStatus;
+	}
+
+	_connecting = true;
+	_connectStart = millis();
+	_connectLastPoll = _connectStart;
+	_connectTimeout = timeout;
+	setConnectionStatus(WL_IDLE_STATUS);
+	return WL_IDLE_STATUS;
+}
+
+uint8_t WiFiClass::waitConnection()
+{
+	while (_connecting)
+	{
+		delay(WL_DELAY_START_CONNECTION);
+		connectionPoll();
+	}
+	return _connectStatus;
+}
+
+uint8_t WiFiClass::connectionPoll()
+{
+	if (!_connecting)
+		return _connectStatus;
+
+	unsigned long now = millis();
+	if (now - _connectLastPoll < WL_DELAY_START_CONNECTION)
+		return _connectStatus;
+	_connectLastPoll = now;
+
+	uint8_t status = WiFiDrv::getConnectionStatus();
+	if (((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) ||
+	    (now - _connectStart >= _connectTimeout))
+	{
+		_connecting = false;
+	}
+	setConnectionStatus(status);
+	return status;
+}
+
+bool WiFiClass::connecting()
+{
+	return _connecting;
+}
+
+void WiFiClass::onStatusChange(WiFiStatusCallback callback)
+{
+	_statusCallback = callback;
+}
+
+void WiFiClass::setConnectionStatus(uint8_t status)
+{
+	uint8_t previous = _connectStatus;
+
+	_connectStatus = status;
+	// only station connections with saved credentials are watched
+	if (status == WL_CONNECTED && _reconnectSsid[0] != 0)
+		_linkUp = true;
+	if (status != previous && _statusCallback)
+		_statusCallback(status);
+}
+
+void WiFiClass::setAutoReconnect(bool enable)
+{
+	_autoReconnect = enable;
+	_reconnectState = RECONNECT_IDLE;
+}
+
+void WiFiClass::onReconnect(WiFiReconnectCallback callback)
+{
+	_reconnectCallback = callback;
+}
+
+void WiFiClass::saveCredentials(const char* ssid, const char* passphrase)
+{
+	strncpy(_reconnectSsid, ssid, WL_SSID_MAX_LENGTH);
+	_reconnectSsid[WL_SSID_MAX_LENGTH] = 0;
+	_reconnectPassphrase[0] = 0;
+	if (passphrase != NULL)
+	{
+		strncpy(_reconnectPassphrase, passphrase, WL_PMK_LENGTH * 2);
+		_reconnectPassphrase[WL_PMK_LENGTH * 2] = 0;
+	}
+	// a new begin is not an outage
+	_linkUp = false;
+	_reconnectState = RECONNECT_IDLE;
+}
+
+void WiFiClass::clearCredentials()
+{
+	// the new connection is not reconnected, nor the previous one
+	_reconnectSsid[0] = 0;
+	_reconnectPassphrase[0] = 0;
+	_linkUp = false;
+	_reconnectState = RECONNECT_IDLE;
+}
+
+void WiFiClass::scheduleReconnect(unsigned long now)
+{
+	// spread the attempts of devices that lost the same access point,
+	// random() starts from the same seed on every device
+	if (!_reconnectSeeded)
+	{
+		uint8_t mac[WL_MAC_ADDR_LENGTH];
+		unsigned long seed = micros();
+
+		macAddress(mac);
+		for (uint8_t i = 0; i < WL_MAC_ADDR_LENGTH; i++)
+		{
+			seed = seed * 31 + mac[i];
+		}
+		randomSeed(seed);
+		_reconnectSeeded = true;
+	}
+
+	_reconnectStart = now;
+	_reconnectWait = _reconnectDelay / 2 + random(_reconnectDelay / 2 + 1);
+	_reconnectState = RECONNECT_WAITING;
+}
+
+void WiFiClass::reconnectPoll()
+{
+	unsigned long now = millis();
+	uint8_t status;
+
+	switch (_reconnectState)
+	{
+	case RECONNECT_IDLE:
+		if (!_linkUp || _connecting || now - _reconnectCheck < WIFI_RECONNECT_CHECK_INTERVAL)
+			return;
+		_reconnectCheck = now;
+
+		status = WiFiDrv::getConnectionStatus();
+		if (status == WL_CONNECTED)
+			return;
+
+		// the module left station mode, this is not an outage
+		if (status == WL_AP_LISTENING || status == WL_AP_CONNECTED || status == WL_AP_FAILED)
+		{
+			_linkUp = false;
+			return;
+		}
+
+		_linkUp = false;
+		_outageStart = now;
+		_reconnectDelay = WIFI_RECONNECT_MIN_DELAY;
+		scheduleReconnect(now);
+		if (_reconnectCallback)
+			_reconnectCallback(WIFI_LINK_LOST, 0);
+		break;
+
+	case RECONNECT_WAITING:
+		if (now - _reconnectStart < _reconnectWait)
+			return;
+
+		if (_reconnectPassphrase[0] != 0)
+			startConnection(WiFiDrv::wifiSetPassphrase(_reconnectSsid, strlen(_reconnectSsid), _reconnectPassphrase, strlen(_reconnectPassphrase)), WL_CONNECT_FAILED, _timeout);
+		else
+			startConnection(WiFiDrv::wifiSetNetwork(_reconnectSsid, strlen(_reconnectSsid)), WL_CONNECT_FAILED, _timeout);
+		_reconnectState = RECONNECT_CONNECTING;
+		break;
+
+	case RECONNECT_CONNECTING:
+		if (_connecting)
+			return;
+
+		if (_connectStatus == WL_CONNECTED)
+		{
+			_reconnectState = RECONNECT_IDLE;
+			_reconnectCheck = now;
+
+			WiFiServer::restartAll();
+			WiFiUDP::restartAll();
+
+			if (_reconnectCallback)
+				_reconnectCallback(WIFI_LINK_RESTORED, now - _outageStart);
+		} else {
+			_reconnectDelay *= 2;
+			if (_reconnectDelay > WIFI_RECONNECT_MAX_DELAY)
+				_reconnectDelay = WIFI_RECONNECT_MAX_DELAY;
+			scheduleReconnect(now);
+		}
+		break;
+	}
+}
+
+void WiFiClass::setFastReconnect(bool enable)
+{
+	_fastReconnect = enable;
+	_lastNetworkValid = false;
+}
+
+bool WiFiClass::beginFast(const char* ssid, const char* passphrase)
+{
+	if (!_fastReconnect || !_lastNetworkValid || strcmp(ssid, _lastSsid) != 0 ||
+	    !WiFiDrv::hasCapability(CAP_BSSID_CONNECT))
+		return false;
+
+	if (beginBssid(ssid, passphrase, _lastBssid, _lastChannel, WIFI_FAST_RECONNECT_TIMEOUT) == WL_CONNECTED)
+		return true;
+
+	// the access point moved or is gone, scan for the SSID again
+	_lastNetworkValid = false;
+	return false;
+}
+
+void WiFiClass::rememberNetwork(const char* ssid, uint8_t status)
+{
+	// without BSSID connects the access point is of no use
+	if (!_fastReconnect || status != WL_CONNECTED || !WiFiDrv::hasCapability(CAP_BSSID_CONNECT))
+		return;
+
+	uint8_t* bssid = WiFiDrv::getCurrentBSSID();
+
+	if (!_lastNetworkValid || strcmp(ssid, _lastSsid) != 0 || memcmp(bssid, _lastBssid, WL_MAC_ADDR_LENGTH) != 0)
+	{
+		strncpy(_lastSsid, ssid, WL_SSID_MAX_LENGTH);
+		_lastSsid[WL_SSID_MAX_LENGTH] = 0;
+		memcpy(_lastBssid, bssid, WL_MAC_ADDR_LENGTH);
+
+		// take the channel from the last scan, the module scans all channels if unknown
+		_lastChannel = 0;
+		for (int i = 0; i < _scanResult; i++)
+		{
+			uint8_t scanBssid[WL_MAC_ADDR_LENGTH];
+
+			if (memcmp(BSSID(i, scanBssid), _lastBssid, WL_MAC_ADDR_LENGTH) == 0)
+			{
+				_lastChannel = channel(i);
+				break;
+			}
+		}
+		_lastNetworkValid = true;
+	}
 }
 
 uint8_t WiFiClass::beginAP(const char *ssid)
@@ -111,23 +460,9 @@ uint8_t WiFiClass::beginAP(const char *ssid)
 
 uint8_t WiFiClass::beginAP(const char *ssid, uint8_t channel)
 {
-	uint8_t status = WL_IDLE_STATUS;
-
-   if (WiFiDrv::wifiSetApNetwork(ssid, strlen(ssid), channel) != WL_FAILURE)
-   {
-	   for (unsigned long start = millis(); (millis() - start) < _timeout;)
-	   {
-		   delay(WL_DELAY_START_CONNECTION);
-		   status = WiFiDrv::getConnectionStatus();
-		   if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-		     break;
-		   }
-	   }
-   }else
-   {
-	   status = WL_AP_FAILED;
-   }
-   return status;
+	if (beginAPAsync(ssid, channel) == WL_AP_FAILED)
+		return WL_AP_FAILED;
+	return waitConnection();
 }
 
 uint8_t WiFiClass::beginAP(const char *ssid, const char* passphrase)
@@ -137,23 +472,23 @@ uint8_t WiFiClass::beginAP(const char *ssid, const char* passphrase)
 
 uint8_t WiFiClass::beginAP(const char *ssid, const char* passphrase, uint8_t channel)
 {
-	uint8_t status = WL_IDLE_STATUS;
-
-    // set passphrase
-    if (WiFiDrv::wifiSetApPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase), channel)!= WL_FAILURE)
-    {
-	   for (unsigned long start = millis(); (millis() - start) < _timeout;)
-	   {
- 		   delay(WL_DELAY_START_CONNECTION);
- 		   status = WiFiDrv::getConnectionStatus();
-		   if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-		     break;
-		   }
- 	   }
-    }else{
-    	status = WL_AP_FAILED;
-    }
-    return status;
+	if (beginAPAsync(ssid, passphrase, channel) == WL_AP_FAILED)
+		return WL_AP_FAILED;
+	return waitConnection();
+}
+
+uint8_t WiFiClass::beginAPAsync(const char *ssid, uint8_t channel)
+{
+	clearCredentials();
+	return startConnection(WiFiDrv::wifiSetApNetwork(ssid, strlen(ssid), channel), WL_AP_FAILED, _timeout);
+}
+
+uint8_t WiFiClass::beginAPAsync(const char *ssid, const char* passphrase, uint8_t channel)
+{
+	clearCredentials();
+
+	// set passphrase
+	return startConnection(WiFiDrv::wifiSetApPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase), channel), WL_AP_FAILED, _timeout);
 }
 
 uint8_t WiFiClass::beginEnterprise(const char* ssid, const char* username, const char* password)
@@ -168,23 +503,18 @@ uint8_t WiFiClass::beginEnterprise(const char* ssid, const char* username, const
 
 uint8_t WiFiClass::beginEnterprise(const char* ssid, const char* username, const char* password, const char* identity, const char* ca)
 {
-	uint8_t status = WL_IDLE_STATUS;
+	if (beginEnterpriseAsync(ssid, username, password, identity, ca) == WL_CONNECT_FAILED)
+		return WL_CONNECT_FAILED;
+	return waitConnection();
+}
+
+uint8_t WiFiClass::beginEnterpriseAsync(const char* ssid, const char* username, const char* password, const char* identity, const char* ca)
+{
+	clearCredentials();
 
 	// set passphrase
-	if (WiFiDrv::wifiSetEnterprise(0 /*PEAP/MSCHAPv2*/, ssid, strlen(ssid), username, strlen(username), password, strlen(password), identity, strlen(identity), ca, strlen(ca) + 1)!= WL_FAILURE)
-	{
-		for (unsigned long start = millis(); (millis() - start) < _timeout;)
-		{
-			delay(WL_DELAY_START_CONNECTION);
-			status = WiFiDrv::getConnectionStatus();
-			if ((status != WL_IDLE_STATUS) && (status != WL_NO_SSID_AVAIL) && (status != WL_SCAN_COMPLETED)) {
-				break;
-			}
-		}
-	} else {
-		status = WL_CONNECT_FAILED;
-	}
-	return status;
+	return startConnection(WiFiDrv::wifiSetEnterprise(0 /*PEAP/MSCHAPv2*/, ssid, strlen(ssid), username, strlen(username), password, strlen(password), identity, strlen(identity), ca, strlen(ca) + 1),
+		WL_CONNECT_FAILED, _timeout);
 }
 
 void WiFiClass::config(IPAddress local_ip)
@@ -227,11 +557,17 @@ void WiFiClass::setHostname(const char* name)
 
 int WiFiClass::disconnect()
 {
+    // do not reconnect after an intended disconnect
+    _connecting = false;
+    _linkUp = false;
+    _reconnectState = RECONNECT_IDLE;
     return WiFiDrv::disconnect();
 }
 
 void WiFiClass::end(void)
 {
+	_linkUp = false;
+	_reconnectState = RECONNECT_IDLE;
 	WiFiDrv::wifiDriverDeinit();
 }
 
@@ -285,23 +621,106 @@ uint8_t WiFiClass::encryptionType()
     return WiFiDrv::getCurrentEncryptionType();
 }
 
+int WiFiClass::linkInfo(WiFiLinkInfo& info)
+{
+	if (WiFiDrv::hasCapability(CAP_LINK_INFO))
+	{
+		return WiFiDrv::getLinkInfo(&info);
+	}
+
+	memset(&info, 0x00, sizeof(info));
+	if (WiFiDrv::getConnectionStatus() != WL_CONNECTED)
+		return 0;
+
+	strncpy(info.ssid, WiFiDrv::getCurrentSSID(), WL_SSID_MAX_LENGTH);
+	memcpy(info.bssid, WiFiDrv::getCurrentBSSID(), WL_MAC_ADDR_LENGTH);
+	info.rssi = WiFiDrv::getCurrentRSSI();
+	info.encryptionType = WiFiDrv::getCurrentEncryptionType();
+	info.connectedTime = WiFiDrv::getConnectedTime();
+	return 1;
+}
+
 
 int8_t WiFiClass::scanNetworks()
 {
-	uint8_t attempts = 10;
-	uint8_t numOfNetworks = 0;
+	if (scanNetworksAsync() == WL_FAILURE)
+		return WL_FAILURE;
+	return waitScanComplete();
+}
 
-	if (WiFiDrv::startScanNetworks() == WL_FAILURE)
+int8_t WiFiClass::scanNetworks(uint16_t channelMask, bool passive, uint16_t dwellTime, const char* ssid)
+{
+	if (scanNetworksAsync(channelMask, passive, dwellTime, ssid) == WL_FAILURE)
 		return WL_FAILURE;
- 	do
- 	{
- 		delay(2000);
- 		numOfNetworks = WiFiDrv::getScanNetworks();
- 	}
-	while (( numOfNetworks == 0)&&(--attempts>0));
+	return waitScanComplete();
+}
+
+int8_t WiFiClass::waitScanComplete()
+{
+	int8_t numOfNetworks;
+
+	do
+	{
+		delay(WIFI_SCAN_POLL_INTERVAL);
+		numOfNetworks = scanComplete();
+	}
+	while (numOfNetworks == WIFI_SCAN_RUNNING);
 	return numOfNetworks;
 }
 
+int8_t WiFiClass::scanNetworksAsync()
+{
+	return scanNetworksAsync(WL_SCAN_ALL_CHANNELS);
+}
+
+int8_t WiFiClass::scanNetworksAsync(uint16_t channelMask, bool passive, uint16_t dwellTime, const char* ssid)
+{
+	int8_t result;
+
+	_scanning = false;
+	_scanResult = WIFI_SCAN_FAILED;
+
+	if (channelMask == WL_SCAN_ALL_CHANNELS && !passive && dwellTime == 0 && ssid == NULL)
+		result = WiFiDrv::startScanNetworks();
+	else
+		result = WiFiDrv::startScanNetworks(channelMask, passive, dwellTime, ssid);
+	if (result == WL_FAILURE)
+		return WL_FAILURE;
+
+	_scanning = true;
+	_scanStart = millis();
+	_scanLastPoll = _scanStart;
+	return WL_SUCCESS;
+}
+
+int8_t WiFiClass::scanComplete()
+{
+	if (!_scanning)
+		return _scanResult;
+
+	unsigned long now = millis();
+	if (now - _scanLastPoll < WIFI_SCAN_POLL_INTERVAL)
+		return WIFI_SCAN_RUNNING;
+	_scanLastPoll = now;
+
+	// the module reports no networks until the scan is done; current
+	// firmware scans synchronously here and replies once it is done
+	uint8_t numOfNetworks = WiFiDrv::getScanNetworks();
+	if (numOfNetworks == 0 && now - _scanStart < WIFI_SCAN_TIMEOUT)
+		return WIFI_SCAN_RUNNING;
+
+	_scanning = false;
+	_scanResult = numOfNetworks;
+	if (_scanCallback)
+		_scanCallback(_scanResult);
+	return _scanResult;
+}
+
+void WiFiClass::onScanComplete(WiFiScanCallback callback)
+{
+	_scanCallback = callback;
+}
+
 const char* WiFiClass::SSID(uint8_t networkItem)
 {
 	return WiFiDrv::getSSIDNetoworks(networkItem);
@@ -317,6 +736,142 @@ uint8_t WiFiClass::encryptionType(uint8_t networkItem)
     return WiFiDrv::getEncTypeNetowrks(networkItem);
 }
 
+int WiFiClass::scanResults(WiFiScanResult* results, uint8_t count, uint8_t first)
+{
+	if (_scanResult <= 0)
+		return 0;
+
+	if (WiFiDrv::hasCapability(CAP_SCAN_RESULTS))
+	{
+		if (count > 255 - first)
+			count = 255 - first;
+		return WiFiDrv::getScanResults(first, count, results);
+	}
+
+	if (first >= _scanResult)
+		return 0;
+	if (count > _scanResult - first)
+		count = _scanResult - first;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		const char* ssid = SSID(first + i);
+
+		memset(&results[i], 0x00, sizeof(WiFiScanResult));
+		if (ssid != NULL)
+			strncpy(results[i].ssid, ssid, WL_SSID_MAX_LENGTH);
+		results[i].rssi = RSSI(first + i);
+		results[i].encryptionType = encryptionType(first + i);
+		BSSID(first + i, results[i].bssid);
+		results[i].channel = channel(first + i);
+	}
+	return count;
+}
+
+int WiFiClass::scanBest(WiFiScanResult* results, uint8_t count, bool dedup)
+{
+	WiFiScanResult page[WL_SCAN_RESULTS_BATCH];
+	uint8_t numResults = 0;
+	uint8_t first = 0;
+
+	while (first < 255)
+	{
+		int n = scanResults(page, WL_SCAN_RESULTS_BATCH, first);
+
+		for (int i = 0; i < n; i++)
+		{
+			insertScanResult(results, &numResults, count, page[i], dedup);
+		}
+		first += n;
+
+		if (n < WL_SCAN_RESULTS_BATCH)
+			break;
+	}
+	return numResults;
+}
+
+void WiFiClass::insertScanResult(WiFiScanResult* results, uint8_t* numResults, uint8_t count,
+    const WiFiScanResult& result, bool dedup)
+{
+	uint8_t pos;
+
+	if (dedup && result.ssid[0] != 0)
+	{
+		for (pos = 0; pos < *numResults; pos++)
+		{
+			if (strcmp(results[pos].ssid, result.ssid) == 0)
+				break;
+		}
+		if (pos < *numResults)
+		{
+			if (results[pos].rssi >= result.rssi)
+				return;
+			// drop the weaker BSSID of the same SSID
+			memmove(&results[pos], &results[pos + 1], (*numResults - pos - 1) * sizeof(WiFiScanResult));
+			(*numResults)--;
+		}
+	}
+
+	for (pos = 0; pos < *numResults; pos++)
+	{
+		if (result.rssi > results[pos].rssi)
+			break;
+	}
+	if (pos >= count)
+		return;
+
+	if (*numResults == count)
+		(*numResults)--;
+	memmove(&results[pos + 1], &results[pos], (*numResults - pos) * sizeof(WiFiScanResult));
+	results[pos] = result;
+	(*numResults)++;
+}
+
+void WiFiClass::sortScanResults(WiFiScanResult* results, uint8_t count)
+{
+	for (uint8_t i = 1; i < count; i++)
+	{
+		WiFiScanResult result = results[i];
+		uint8_t j = i;
+
+		while (j > 0 && results[j - 1].rssi < result.rssi)
+		{
+			results[j] = results[j - 1];
+			j--;
+		}
+		results[j] = result;
+	}
+}
+
+uint8_t WiFiClass::dedupScanResults(WiFiScanResult* results, uint8_t count)
+{
+	uint8_t numResults = 0;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t j = 0;
+
+		if (results[i].ssid[0] != 0)
+		{
+			for (j = 0; j < numResults; j++)
+			{
+				if (strcmp(results[j].ssid, results[i].ssid) == 0)
+					break;
+			}
+		} else {
+			j = numResults;
+		}
+
+		if (j == numResults)
+		{
+			results[numResults++] = results[i];
+		} else if (results[i].rssi > results[j].rssi) {
+			results[j] = results[i];
+		}
+	}
+	return numResults;
+}
+
 uint8_t* WiFiClass::BSSID(uint8_t networkItem, uint8_t* bssid)
 {
 	return WiFiDrv::getBSSIDNetowrks(networkItem, bssid);
@@ -342,6 +897,36 @@ int WiFiClass::hostByName(const char* aHostname, IPAddress& aResult)
 	return WiFiDrv::getHostByName(aHostname, aResult);
 }
 
+int WiFiClass::prefetchHostByName(const char* aHostname)
+{
+	return WiFiDrv::prefetchHostByName(aHostname);
+}
+
+void WiFiClass::flushDNSCache(const char* aHostname)
+{
+	WiFiDrv::flushDnsCache(aHostname);
+}
+
+void WiFiClass::setDNSCacheTTL(unsigned long ttl, unsigned long negativeTtl)
+{
+	WiFiDrv::setDnsCacheTtl(ttl, negativeTtl);
+}
+
+int WiFiClass::resolveAsync(const char* aHostname)
+{
+	return WiFiDrv::reqHostByNameAsync(aHostname);
+}
+
+int WiFiClass::resolvePoll(int handle, IPAddress& aResult)
+{
+	return WiFiDrv::getHostByNameAsync(handle, aResult);
+}
+
+void WiFiClass::resolveCancel(int handle)
+{
+	WiFiDrv::cancelHostByNameAsync(handle);
+}
+
 unsigned long WiFiClass::getTime()
 {
 	return WiFiDrv::getTime();
@@ -357,6 +942,16 @@ void WiFiClass::noLowPowerMode()
 	WiFiDrv::setPowerMode(0);
 }
 
+int WiFiClass::setTLSSessionCache(bool enable)
+{
+	return (WiFiDrv::setTlsSessionCache(enable ? TLS_SESSION_CACHE_ENABLE : TLS_SESSION_CACHE_DISABLE) == WL_SUCCESS);
+}
+
+int WiFiClass::clearTLSSessionCache()
+{
+	return (WiFiDrv::setTlsSessionCache(TLS_SESSION_CACHE_CLEAR) == WL_SUCCESS);
+}
+
 int WiFiClass::ping(const char* hostname, uint8_t ttl)
 {
 	IPAddress ip;
@@ -382,4 +977,24 @@ void WiFiClass::setTimeout(unsigned long timeout)
 {
 	_timeout = timeout;
 }
+
+void WiFiClass::poll()
+{
+	WiFiServer::pollAll(ServerDrv::getSocketsReady());
+
+	if (_scanning)
+	{
+		scanComplete();
+	}
+
+	if (_connecting)
+	{
+		connectionPoll();
+	}
+
+	if (_autoReconnect && _reconnectSsid[0] != 0)
+	{
+		reconnectPoll();
+	}
+}
 WiFiClass WiFi;
@@ -34,6 +34,53 @@ extern "C" {
 #include "WiFiClient.h"
 #include "WiFiSSLClient.h"
 #include "WiFiServer.h"
+#include "utility/wifi_pmk.h"
+
+// results of WiFiClass::scanComplete(), besides the number of networks found
+#define WIFI_SCAN_FAILED	WL_FAILURE
+#define WIFI_SCAN_RUNNING	(-2)
+
+// interval between queries for the results of a running scan
+#define WIFI_SCAN_POLL_INTERVAL	100
+// time after which a scan without results is considered done
+#define WIFI_SCAN_TIMEOUT	20000
+
+// time given to a fast reconnect before falling back to a regular connect
+#define WIFI_FAST_RECONNECT_TIMEOUT	5000
+
+typedef void (*WiFiScanCallback)(int8_t networks);
+typedef void (*WiFiStatusCallback)(uint8_t status);
+
+// events of WiFiClass::onReconnect()
+#define WIFI_LINK_LOST		0
+#define WIFI_LINK_RESTORED	1
+
+// interval between link checks of the auto reconnect
+#define WIFI_RECONNECT_CHECK_INTERVAL	1000
+// range of the delay before a reconnect attempt, doubled after each failure
+#define WIFI_RECONNECT_MIN_DELAY	500
+#define WIFI_RECONNECT_MAX_DELAY	60000
+
+typedef void (*WiFiReconnectCallback)(uint8_t event, unsigned long outage);
+
+// network discovered by a scan, see WiFiClass::scanResults()
+struct WiFiScanResult {
+    char ssid[WL_SSID_MAX_LENGTH + 1];
+    int32_t rssi;
+    uint8_t encryptionType;             // one value of wl_enc_type enum
+    uint8_t bssid[WL_MAC_ADDR_LENGTH];  // same byte order as BSSID(networkItem, bssid)
+    uint8_t channel;
+};
+
+// snapshot of the current network, see WiFiClass::linkInfo()
+struct WiFiLinkInfo {
+    char ssid[WL_SSID_MAX_LENGTH + 1];
+    uint8_t bssid[WL_MAC_ADDR_LENGTH];  // same byte order as BSSID(bssid)
+    int32_t rssi;
+    uint8_t encryptionType;             // one value of wl_enc_type enum
+    uint8_t channel;                    // 0 if not reported by the firmware
+    unsigned long connectedTime;        // milliseconds since the association
+};
 
 class WiFiClass
 {
@@ -41,6 +88,56 @@ private:
 
     static void init();
     unsigned long _timeout;
+    bool _scanning;
+    int8_t _scanResult;
+    unsigned long _scanStart;
+    unsigned long _scanLastPoll;
+    WiFiScanCallback _scanCallback;
+    bool _fastReconnect;
+    bool _lastNetworkValid;
+    char _lastSsid[WL_SSID_MAX_LENGTH + 1];
+    uint8_t _lastBssid[WL_MAC_ADDR_LENGTH];
+    uint8_t _lastChannel;
+    bool _pmkCache;
+    bool _pmkValid;
+    char _pmkSsid[WL_SSID_MAX_LENGTH + 1];
+    char _pmkPassphrase[WL_WPA_KEY_MAX_LENGTH + 1];
+    uint8_t _pmk[WL_PMK_LENGTH];
+    bool _connecting;
+    uint8_t _connectStatus;
+    unsigned long _connectStart;
+    unsigned long _connectLastPoll;
+    unsigned long _connectTimeout;
+    WiFiStatusCallback _statusCallback;
+    bool _autoReconnect;
+    bool _linkUp;
+    uint8_t _reconnectState;
+    unsigned long _reconnectCheck;
+    unsigned long _reconnectStart;
+    unsigned long _reconnectWait;
+    unsigned long _reconnectDelay;
+    bool _reconnectSeeded;
+    unsigned long _outageStart;
+    char _reconnectSsid[WL_SSID_MAX_LENGTH + 1];
+    char _reconnectPassphrase[WL_PMK_LENGTH * 2 + 1];
+    WiFiReconnectCallback _reconnectCallback;
+
+    int8_t waitScanComplete();
+    uint8_t startConnection(int8_t result, uint8_t failStatus, unsigned long timeout);
+    uint8_t waitConnection();
+    void setConnectionStatus(uint8_t status);
+    const char* cachedPassphrase(const char* ssid, const char* passphrase, char* pmkHex, bool derive = true);
+    int beginBssid(const char* ssid, const char* passphrase, const uint8_t* bssid, uint8_t channel, unsigned long timeout);
+    bool beginFast(const char* ssid, const char* passphrase);
+    void rememberNetwork(const char* ssid, uint8_t status);
+    static void pmkToHex(const uint8_t* pmk, char* hex);
+    void saveCredentials(const char* ssid, const char* passphrase);
+    void clearCredentials();
+    void scheduleReconnect(unsigned long now);
+    void reconnectPoll();
+
+    static void insertScanResult(WiFiScanResult* results, uint8_t* numResults, uint8_t count,
+        const WiFiScanResult& result, bool dedup);
 public:
     WiFiClass();
 
@@ -75,6 +172,57 @@ public:
      */
     int begin(const char* ssid, const char *passphrase);
 
+    /* Start Wifi connection to a specific access point, without scanning
+     * for the SSID. Firmware that does not support it connects to any
+     * access point of the SSID.
+     *
+     * param ssid: Pointer to the SSID string.
+     * param passphrase: Passphrase, NULL for an open network.
+     * param bssid: BSSID of the access point, in the order of BSSID(bssid)
+     * param channel: Channel of the access point, 0 if unknown.
+     */
+    int begin(const char* ssid, const char* passphrase, const uint8_t* bssid, uint8_t channel);
+
+    /* Start Wifi connection to a WPA2 network with a precomputed pairwise
+     * master key, the module skips deriving it from the passphrase
+     *
+     * param ssid: Pointer to the SSID string.
+     * param pmk: WL_PMK_LENGTH bytes key, see derivePMK
+     */
+    int beginPMK(const char* ssid, const uint8_t* pmk);
+
+    /* Derive the pairwise master key of a WPA2 network, on the module if
+     * the firmware supports it, on the host otherwise. The host runs 4096
+     * PBKDF2 iterations, which takes well over ten seconds on AVR boards.
+     * Store the key to connect later with beginPMK.
+     *
+     * param ssid: Pointer to the SSID string.
+     * param passphrase: Passphrase of the network, 8 to 63 characters.
+     * param pmk: buffer of WL_PMK_LENGTH bytes for the result
+     *
+     * return: 1 on success, 0 if the SSID or passphrase length is invalid
+     */
+    int derivePMK(const char* ssid, const char* passphrase, uint8_t* pmk);
+
+    /* Derive the pairwise master key on the first begin(ssid, passphrase)
+     * and connect with it on the next ones for the same network.
+     * Deriving the key blocks the first begin once, for several seconds on
+     * ARM boards and over ten seconds on AVR without CAP_DERIVE_PMK.
+     * beginAsync(ssid, passphrase) never derives it, it only uses a key
+     * derived by an earlier begin.
+     *
+     * param enable: true to cache the key
+     */
+    void setPMKCache(bool enable);
+
+    /* Remember the access point of the last successful begin and try it
+     * first on the next begin for the same SSID. Needs firmware with
+     * CAP_BSSID_CONNECT, otherwise begin connects as usual.
+     *
+     * param enable: true to enable fast reconnects
+     */
+    void setFastReconnect(bool enable);
+
     uint8_t beginAP(const char *ssid);
     uint8_t beginAP(const char *ssid, uint8_t channel);
     uint8_t beginAP(const char *ssid, const char* passphrase);
@@ -84,6 +232,58 @@ public:
     uint8_t beginEnterprise(const char* ssid, const char* username, const char* password, const char* identity);
     uint8_t beginEnterprise(const char* ssid, const char* username, const char* password, const char* identity, const char* ca);
 
+    /* Start a connection like the begin, beginAP and beginEnterprise
+     * functions, without waiting for it. Follow it with connectionPoll()
+     * or onStatusChange(). The fast reconnect of setFastReconnect is not
+     * used.
+     *
+     * return: WL_IDLE_STATUS if the connection was started,
+     *         WL_CONNECT_FAILED or WL_AP_FAILED otherwise
+     */
+    int beginAsync(const char* ssid);
+    int beginAsync(const char* ssid, uint8_t key_idx, const char* key);
+    int beginAsync(const char* ssid, const char *passphrase);
+    uint8_t beginAPAsync(const char *ssid, uint8_t channel = 1);
+    uint8_t beginAPAsync(const char *ssid, const char* passphrase, uint8_t channel = 1);
+    uint8_t beginEnterpriseAsync(const char* ssid, const char* username, const char* password, const char* identity = "", const char* ca = "");
+
+    /* Check the connection started by beginAsync, the module is queried
+     * at most every WL_DELAY_START_CONNECTION ms. The attempt is over when
+     * connecting() returns false, at the latest after the setTimeout time.
+     *
+     * return: one of the value defined in wl_status_t
+     */
+    uint8_t connectionPoll();
+
+    /*
+     * return: true while a connection started by a begin function is in progress
+     */
+    bool connecting();
+
+    /* Set the function called with the new status when the status of a
+     * connection started by a begin function changes. Connections in
+     * progress are checked by poll()
+     */
+    void onStatusChange(WiFiStatusCallback callback);
+
+    /* Reconnect to the network of the last begin(ssid) or begin(ssid, passphrase)
+     * when the link is lost, with a randomized delay doubled after each
+     * failed attempt. After a reconnect the servers and the UDP sockets
+     * started with begin() or beginMulticast() are started again, with
+     * their multicast groups. Driven by poll(), which checks the link
+     * every WIFI_RECONNECT_CHECK_INTERVAL ms. WEP and enterprise networks
+     * and access point mode are not reconnected, their begin functions
+     * stop the reconnection of an earlier network.
+     *
+     * param enable: true to enable the automatic reconnection
+     */
+    void setAutoReconnect(bool enable);
+
+    /* Set the function called with WIFI_LINK_LOST when the link is lost and
+     * WIFI_LINK_RESTORED with the outage duration in ms when it is restored
+     */
+    void onReconnect(WiFiReconnectCallback callback);
+
     /* Change Ip configuration settings disabling the dhcp client
         *
         * param local_ip: 	Static ip configuration
@@ -203,6 +403,18 @@ public:
       */
     uint8_t	encryptionType();
 
+    /*
+     * Get SSID, BSSID, RSSI, encryption type, channel and connected time of
+     * the current network at once. Firmware with CAP_LINK_INFO reports all
+     * of them in one command, otherwise they are queried one by one and the
+     * channel is 0.
+     *
+     * param info: record to fill
+     *
+     * return: 1 on success, 0 if not connected
+     */
+    int linkInfo(WiFiLinkInfo& info);
+
     /*
      * Start scan WiFi networks available
      *
@@ -210,6 +422,46 @@ public:
      */
     int8_t scanNetworks();
 
+    /*
+     * Start scan WiFi networks available with the given options. Firmware
+     * that does not support scan options runs a full scan.
+     *
+     * param channelMask: channels to scan, e.g. WL_SCAN_CHANNEL(1) | WL_SCAN_CHANNEL(6)
+     * param passive: listen for beacons instead of sending probe requests
+     * param dwellTime: time spent on each channel in ms, 0 for the firmware default
+     * param ssid: report only the network with this SSID, NULL for all
+     *
+     * return: Number of discovered networks
+     */
+    int8_t scanNetworks(uint16_t channelMask, bool passive = false, uint16_t dwellTime = 0, const char* ssid = NULL);
+
+    /*
+     * Start scan WiFi networks available without waiting for the results,
+     * see scanComplete() for the firmware limits
+     *
+     * return: WL_SUCCESS if the scan was started, WL_FAILURE otherwise
+     */
+    int8_t scanNetworksAsync();
+    int8_t scanNetworksAsync(uint16_t channelMask, bool passive = false, uint16_t dwellTime = 0, const char* ssid = NULL);
+
+    /*
+     * Check the scan started with scanNetworksAsync, the module is queried
+     * at most every WIFI_SCAN_POLL_INTERVAL ms.
+     * Current firmware runs the whole scan when it is first queried and
+     * only replies once the scan is done, so the first query after
+     * WIFI_SCAN_POLL_INTERVAL ms blocks for the duration of the scan.
+     *
+     * return: Number of discovered networks, WIFI_SCAN_RUNNING while the scan
+     *         is in progress or WIFI_SCAN_FAILED if no scan was started
+     */
+    int8_t scanComplete();
+
+    /*
+     * Set the function called with the number of discovered networks when
+     * a scan completes. Running scans are checked by poll()
+     */
+    void onScanComplete(WiFiScanCallback callback);
+
     /*
      * Return the SSID discovered during the network scan.
      *
@@ -240,6 +492,46 @@ public:
      */
     int32_t RSSI(uint8_t networkItem);
 
+    /*
+     * Get SSID, RSSI, encryption type, BSSID and channel of the networks
+     * discovered by the last scan. Firmware with CAP_SCAN_RESULTS sends all
+     * of them in one transfer and pages through networks beyond the
+     * WL_NETWORKS_LIST_MAXNUM reported by scanNetworks, otherwise they are
+     * queried one by one.
+     *
+     * param results: array of at least count records
+     * param count: maximum number of records to get
+     * param first: index of the first network item
+     *
+     * return: number of records stored in results
+     */
+    int scanResults(WiFiScanResult* results, uint8_t count, uint8_t first = 0);
+
+    /*
+     * Get the count strongest networks discovered by the last scan, out of
+     * all the networks the module reports, sorted by RSSI.
+     *
+     * param results: array of at least count records
+     * param count: maximum number of records to get
+     * param dedup: keep only the strongest BSSID of each SSID
+     *
+     * return: number of records stored in results
+     */
+    int scanBest(WiFiScanResult* results, uint8_t count, bool dedup = true);
+
+    /*
+     * Sort scan results by RSSI, strongest first
+     */
+    static void sortScanResults(WiFiScanResult* results, uint8_t count);
+
+    /*
+     * Remove the scan results of SSIDs seen more than once, keeping the
+     * strongest BSSID. Hidden networks are kept.
+     *
+     * return: number of records left in results
+     */
+    static uint8_t dedupScanResults(WiFiScanResult* results, uint8_t count);
+
     /*
      * Return Connection status.
      *
@@ -263,16 +555,82 @@ public:
      */
     int hostByName(const char* aHostname, IPAddress& aResult);
 
+    /*
+     * Resolve the given hostname ahead of time and store it in the host name cache.
+     * param aHostname: Name to be resolved
+     * result: 1 if the name was resolved, else 0
+     */
+    int prefetchHostByName(const char* aHostname);
+
+    /*
+     * Remove a hostname from the cache, or all of them if aHostname is NULL.
+     */
+    void flushDNSCache(const char* aHostname = NULL);
+
+    /*
+     * Set how long resolved (ttl) and failed (negativeTtl) lookups are cached, in msecs.
+     * A value of 0 disables the respective caching.
+     */
+    void setDNSCacheTTL(unsigned long ttl, unsigned long negativeTtl = WL_DNS_CACHE_DEF_NEG_TTL);
+
+    /*
+     * Queue the resolution of the given hostname.
+     * Cached names complete at once. The others are resolved by the first
+     * resolvePoll() of their handle, and the module only answers a lookup
+     * once it is complete, so that call blocks like hostByName().
+     * param aHostname: Name to be resolved, must stay valid until the lookup completes
+     * result: handle to pass to resolvePoll(), or -1 if too many lookups are outstanding
+     */
+    int resolveAsync(const char* aHostname);
+
+    /*
+     * Check the result of a queued lookup, resolving it first if needed.
+     * Only the lookup of the given handle is run.
+     * param handle: handle returned by resolveAsync()
+     * param aResult: IPAddress structure to store the returned IP address
+     * result: one value of wl_resolve_result_t enum, the handle is released
+     *         once WL_RESOLVE_SUCCESS or WL_RESOLVE_FAILED is returned and
+     *         WL_RESOLVE_INVALID is returned for it afterwards
+     */
+    int resolvePoll(int handle, IPAddress& aResult);
+
+    void resolveCancel(int handle);
+
     unsigned long getTime();
 
     void lowPowerMode();
     void noLowPowerMode();
 
+    /*
+     * Enable or disable resumption of TLS sessions by WiFiSSLClient.
+     * The module keeps the session of each host it connected to, so a
+     * reconnect can skip the full handshake.
+     *
+     * return: 1 on success, 0 if the firmware does not support it
+     */
+    int setTLSSessionCache(bool enable);
+
+    /*
+     * Forget all the TLS sessions stored on the module.
+     *
+     * return: 1 on success, 0 if the firmware does not support it
+     */
+    int clearTLSSessionCache();
+
     int ping(const char* hostname, uint8_t ttl = 128);
     int ping(const String &hostname, uint8_t ttl = 128);
     int ping(IPAddress host, uint8_t ttl = 128);
 
     void setTimeout(unsigned long timeout);
+
+    /*
+     * Dispatch the onAccept, onData and onClose events of the started
+     * servers, the completion of a running scan, the status of a
+     * connection in progress and the auto reconnect. Call it from loop(),
+     * server sockets are queried when NINA_GPIO0 signals pending data and
+     * swept every WIFI_SERVER_SWEEP_INTERVAL ms otherwise.
+     */
+    void poll();
 };
 
 extern WiFiClass WiFi;
@@ -35,10 +35,22 @@ extern "C" {
 
 uint16_t WiFiClient::_srcport = 1024;
 
-WiFiClient::WiFiClient() : _sock(NO_SOCKET_AVAIL) {
+WiFiClient::WiFiClient() :
+  _sock(NO_SOCKET_AVAIL),
+  _connecting(false),
+  _connectStart(0),
+  _connectTimeout(WIFI_CLIENT_DEF_CONN_TIMEOUT),
+  _connectCallback(NULL)
+{
 }
 
-WiFiClient::WiFiClient(uint8_t sock) : _sock(sock) {
+WiFiClient::WiFiClient(uint8_t sock) :
+  _sock(sock),
+  _connecting(false),
+  _connectStart(0),
+  _connectTimeout(WIFI_CLIENT_DEF_CONN_TIMEOUT),
+  _connectCallback(NULL)
+{
 }
 
 int WiFiClient::connect(const char* host, uint16_t port) {
@@ -51,34 +63,61 @@ int WiFiClient::connect(const char* host, uint16_t port) {
 }
 
 int WiFiClient::connect(IPAddress ip, uint16_t port) {
-    if (_sock != NO_SOCKET_AVAIL)
+    if (!connectAsync(ip, port))
     {
-      stop();
+      return 0;
     }
+    return waitConnected();
+}
 
-    _sock = ServerDrv::getSocket();
-    if (_sock != NO_SOCKET_AVAIL)
+int WiFiClient::connectSSL(IPAddress ip, uint16_t port)
+{
+    if (!connectSSLAsync(ip, port))
     {
-    	ServerDrv::startClient(uint32_t(ip), port, _sock);
+      return 0;
+    }
+    return waitConnected();
+}
 
-    	unsigned long start = millis();
+int WiFiClient::connectSSL(const char *host, uint16_t port)
+{
+    if (!connectSSLAsync(host, port))
+    {
+      return 0;
+    }
+    return waitConnected();
+}
 
-    	// wait 4 second for the connection to close
-    	while (!connected() && millis() - start < 10000)
-    		delay(1);
+int WiFiClient::connectAsync(const char* host, uint16_t port) {
+	if (WiFiDrv::hasCapability(CAP_CONNECT_ASYNC))
+	{
+		// the module resolves the name itself
+		return startConnect(uint32_t(0), host, port, TCP_MODE);
+	}
 
-    	if (!connected())
-       	{
-    		return 0;
-    	}
-    } else {
-    	Serial.println("No Socket available");
-    	return 0;
-    }
-    return 1;
+	IPAddress remote_addr;
+	if (WiFi.hostByName(host, remote_addr))
+	{
+		return connectAsync(remote_addr, port);
+	}
+	return 0;
 }
 
-int WiFiClient::connectSSL(IPAddress ip, uint16_t port)
+int WiFiClient::connectAsync(IPAddress ip, uint16_t port) {
+    return startConnect(uint32_t(ip), NULL, port, TCP_MODE);
+}
+
+int WiFiClient::connectSSLAsync(IPAddress ip, uint16_t port)
+{
+    return startConnect(uint32_t(ip), NULL, port, TLS_MODE);
+}
+
+int WiFiClient::connectSSLAsync(const char *host, uint16_t port)
+{
+    return startConnect(uint32_t(0), host, port, TLS_MODE);
+}
+
+int WiFiClient::startConnect(uint32_t ip, const char* host, uint16_t port, uint8_t protMode)
 {
     if (_sock != NO_SOCKET_AVAIL)
     {
@@ -86,54 +125,87 @@ int WiFiClient::connectSSL(IPAddress ip, uint16_t port)
     }
 
     _sock = ServerDrv::getSocket();
-    if (_sock != NO_SOCKET_AVAIL)
+    if (_sock == NO_SOCKET_AVAIL)
     {
-      ServerDrv::startClient(uint32_t(ip), port, _sock, TLS_MODE);
-
-      unsigned long start = millis();
+      Serial.println("No Socket available");
+      return 0;
+    }
 
-      // wait 4 second for the connection to close
-      while (!connected() && millis() - start < 10000)
-        delay(1);
+    if (WiFiDrv::hasCapability(CAP_CONNECT_ASYNC))
+    {
+      uint8_t host_len = (host != NULL) ? strlen(host) : 0;
 
-      if (!connected())
-        {
+      if (!ServerDrv::startClientAsync(host, host_len, ip, port, _sock, protMode))
+      {
+        WiFiSocketBuffer.close(_sock);
+        _sock = NO_SOCKET_AVAIL;
         return 0;
       }
+    } else if (host != NULL)
+    {
+      ServerDrv::startClient(host, strlen(host), ip, port, _sock, protMode);
     } else {
-      Serial.println("No Socket available");
-      return 0;
+      ServerDrv::startClient(ip, port, _sock, protMode);
     }
+
+    _connecting = true;
+    _connectStart = millis();
     return 1;
 }
 
-int WiFiClient::connectSSL(const char *host, uint16_t port)
+int WiFiClient::waitConnected()
 {
-    if (_sock != NO_SOCKET_AVAIL)
-    {
-      stop();
-    }
+    int result;
 
-    _sock = ServerDrv::getSocket();
-    if (_sock != NO_SOCKET_AVAIL)
-    {
-      ServerDrv::startClient(host, strlen(host), uint32_t(0), port, _sock, TLS_MODE);
+    while ((result = connectPoll()) == WIFI_CONNECT_IN_PROGRESS)
+      delay(1);
 
-      unsigned long start = millis();
+    return (result == WIFI_CONNECT_ESTABLISHED);
+}
 
-      // wait 4 second for the connection to close
-      while (!connected() && millis() - start < 10000)
-        delay(1);
+int WiFiClient::connectPoll()
+{
+  if (!_connecting) {
+    return connected() ? WIFI_CONNECT_ESTABLISHED : WIFI_CONNECT_FAILED;
+  }
 
-      if (!connected())
-        {
-        return 0;
-      }
-    } else {
-      Serial.println("No Socket available");
-      return 0;
+  int result = WIFI_CONNECT_ESTABLISHED;
+  uint8_t s = status();
+
+  if (s == SYN_SENT || s == SYN_RCVD) {
+    if (millis() - _connectStart < _connectTimeout) {
+      return WIFI_CONNECT_IN_PROGRESS;
     }
-    return 1;
+
+    // give up, release the socket on the module
+    ServerDrv::stopClient(_sock);
+    result = WIFI_CONNECT_FAILED;
+  } else if (s != ESTABLISHED && !WiFiSocketBuffer.available(_sock)) {
+    result = WIFI_CONNECT_FAILED;
+  }
+
+  _connecting = false;
+
+  if (result == WIFI_CONNECT_FAILED) {
+    WiFiSocketBuffer.close(_sock);
+    _sock = NO_SOCKET_AVAIL;
+  }
+
+  if (_connectCallback != NULL) {
+    _connectCallback(*this, result);
+  }
+
+  return result;
+}
+
+void WiFiClient::onConnected(WiFiClientConnectCallback callback)
+{
+  _connectCallback = callback;
+}
+
+void WiFiClient::setConnectionTimeout(unsigned long timeout)
+{
+  _connectTimeout = timeout;
 }
 
 size_t WiFiClient::write(uint8_t b) {
@@ -214,14 +286,45 @@ void WiFiClient::stop() {
   while (status() != CLOSED && ++count < 50)
     delay(100);
 
+  release();
+}
+
+void WiFiClient::stopAsync() {
+
+  if (_sock == 255)
+    return;
+
+  ServerDrv::stopClient(_sock);
+
+  release();
+}
+
+void WiFiClient::abort() {
+
+  if (_sock == 255)
+    return;
+
+  if (WiFiDrv::hasCapability(CAP_ABORT_CLIENT)) {
+    ServerDrv::abortClient(_sock);
+  } else {
+    ServerDrv::stopClient(_sock);
+  }
+
+  release();
+}
+
+void WiFiClient::release() {
   WiFiSocketBuffer.close(_sock);
   _sock = 255;
+  _connecting = false;
 }
 
 uint8_t WiFiClient::connected() {
 
   if (_sock == 255) {
     return 0;
+  } else if (_connecting) {
+    return (connectPoll() == WIFI_CONNECT_ESTABLISHED);
   } else if (available()) {
     return 1;
   } else {
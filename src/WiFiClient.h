@@ -25,6 +25,18 @@
 #include "Client.h"
 #include "IPAddress.h"
 
+// default time allowed for a connection to be established
+#define WIFI_CLIENT_DEF_CONN_TIMEOUT 10000
+
+// values returned by connectPoll()
+#define WIFI_CONNECT_FAILED       -1
+#define WIFI_CONNECT_IN_PROGRESS   0
+#define WIFI_CONNECT_ESTABLISHED   1
+
+class WiFiClient;
+
+typedef void (*WiFiClientConnectCallback)(WiFiClient& client, int result);
+
 class WiFiClient : public Client {
 
 public:
@@ -36,6 +48,35 @@ public:
   virtual int connect(const char *host, uint16_t port);
   virtual int connectSSL(IPAddress ip, uint16_t port);
   virtual int connectSSL(const char *host, uint16_t port);
+
+  /*
+   * Start a connection and track it with connectPoll() instead of
+   * blocking until it is established.
+   *
+   * Firmware with CAP_CONNECT_ASYNC resolves the host name, connects and
+   * does the TLS handshake in the background, so several connections can
+   * progress at once. Older firmware only answers once the connect or
+   * handshake has completed, and connectAsync(host, port) resolves the
+   * name with WiFi.hostByName() first, so the call blocks as connect() does.
+   *
+   * return: 1 if the connection was started, 0 on failure
+   */
+  int connectAsync(IPAddress ip, uint16_t port);
+  int connectAsync(const char *host, uint16_t port);
+  int connectSSLAsync(IPAddress ip, uint16_t port);
+  int connectSSLAsync(const char *host, uint16_t port);
+
+  /*
+   * Check the progress of a connection started with connect*Async().
+   * The callback set with onConnected() is invoked once the connection
+   * is established or has failed.
+   *
+   * return: WIFI_CONNECT_ESTABLISHED, WIFI_CONNECT_IN_PROGRESS or WIFI_CONNECT_FAILED
+   */
+  int connectPoll();
+  void onConnected(WiFiClientConnectCallback callback);
+
+  void setConnectionTimeout(unsigned long timeout);
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
   virtual int available();
@@ -44,6 +85,19 @@ public:
   virtual int peek();
   virtual void flush();
   virtual void stop();
+
+  /*
+   * Close the connection without waiting for the socket to reach CLOSED.
+   * The handle is released immediately and the module completes the
+   * shutdown in the background.
+   */
+  void stopAsync();
+
+  /*
+   * Abortively close the connection (RST), discarding any unsent data.
+   * Falls back to stopAsync() on firmware without CAP_ABORT_CLIENT.
+   */
+  void abort();
   virtual uint8_t connected();
   virtual operator bool();
 
@@ -56,9 +110,17 @@ public:
   using Print::write;
 
 private:
+  int startConnect(uint32_t ip, const char* host, uint16_t port, uint8_t protMode);
+  int waitConnected();
+  void release();
+
   static uint16_t _srcport;
   uint8_t _sock;   //not used
   uint16_t  _socket;
+  bool _connecting;
+  unsigned long _connectStart;
+  unsigned long _connectTimeout;
+  WiFiClientConnectCallback _connectCallback;
 };
 
 #endif
@@ -38,3 +38,13 @@ int WiFiSSLClient::connect(const char* host, uint16_t port)
 {
 	return WiFiClient::connectSSL(host, port);
 }
+
+int WiFiSSLClient::connectAsync(IPAddress ip, uint16_t port)
+{
+	return WiFiClient::connectSSLAsync(ip, port);
+}
+
+int WiFiSSLClient::connectAsync(const char* host, uint16_t port)
+{
+	return WiFiClient::connectSSLAsync(host, port);
+}
@@ -30,6 +30,11 @@ public:
 
 	virtual int connect(IPAddress ip, uint16_t port);
 	virtual int connect(const char* host, uint16_t port);
+
+	int connectAsync(IPAddress ip, uint16_t port);
+	int connectAsync(const char* host, uint16_t port);
+
+	using WiFiClient::connectAsync;
 };
 
 #endif /* WIFISSLCLIENT_H */
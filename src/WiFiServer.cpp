@@ -19,7 +19,10 @@
 */
 
 #include <string.h>
+#include "utility/spi_drv.h"
 #include "utility/server_drv.h"
+#include "utility/wifi_drv.h"
+#include "utility/WiFiSocketBuffer.h"
 
 extern "C" {
   #include "utility/debug.h"
@@ -29,39 +32,181 @@ extern "C" {
 #include "WiFiClient.h"
 #include "WiFiServer.h"
 
+WiFiServer* WiFiServer::_servers = NULL;
+unsigned long WiFiServer::_lastSweep = 0;
+
 WiFiServer::WiFiServer(uint16_t port) :
   _sock(NO_SOCKET_AVAIL),
-  _lastSock(NO_SOCKET_AVAIL)
+  _lastSock(NO_SOCKET_AVAIL),
+  _clients(0),
+  _budget(WIFI_SERVER_DEF_SERVICE_BUDGET),
+  _acceptCallback(NULL),
+  _dataCallback(NULL),
+  _closeCallback(NULL),
+  _nextServer(NULL)
 {
     _port = port;
 }
 
+WiFiServer::~WiFiServer()
+{
+    for (WiFiServer** server = &_servers; *server != NULL; server = &(*server)->_nextServer)
+    {
+        if (*server == this)
+        {
+            *server = _nextServer;
+            break;
+        }
+    }
+}
+
 void WiFiServer::begin()
 {
     _sock = ServerDrv::getSocket();
     if (_sock != NO_SOCKET_AVAIL)
     {
         ServerDrv::startServer(_port, _sock);
+
+        WiFiServer* server = _servers;
+        while (server != NULL && server != this)
+        {
+            server = server->_nextServer;
+        }
+        if (server == NULL)
+        {
+            _nextServer = _servers;
+            _servers = this;
+        }
+    }
+}
+
+void WiFiServer::restart()
+{
+    for (uint8_t sock = 0; sock < WIFI_MAX_SOCK_NUM; sock++)
+    {
+        if (_clients & (1 << sock))
+        {
+            ServerDrv::stopClient(sock);
+            WiFiSocketBuffer.close(sock);
+
+            if (_closeCallback != NULL)
+            {
+                _closeCallback(sock);
+            }
+        }
+    }
+    _clients = 0;
+    _lastSock = NO_SOCKET_AVAIL;
+
+    if (_sock != NO_SOCKET_AVAIL)
+    {
+        ServerDrv::stopClient(_sock);
+    }
+    begin();
+}
+
+void WiFiServer::restartAll()
+{
+    for (WiFiServer* server = _servers; server != NULL; server = server->_nextServer)
+    {
+        server->restart();
+    }
+}
+
+void WiFiServer::setServiceBudget(uint8_t budget)
+{
+    _budget = (budget > 0) ? budget : 1;
+}
+
+// states of a client socket that will not carry data any more
+static bool isClosedState(uint8_t state)
+{
+    return (state == LISTEN || state == CLOSED || state == FIN_WAIT_1 ||
+            state == FIN_WAIT_2 || state == TIME_WAIT ||
+            state == SYN_SENT || state == SYN_RCVD || state == CLOSE_WAIT);
+}
+
+void WiFiServer::enroll(uint8_t sock)
+{
+    _clients |= (1 << sock);
+
+    if (_acceptCallback != NULL) {
+        WiFiClient client(sock);
+        _acceptCallback(client);
     }
 }
 
+uint8_t WiFiServer::accept()
+{
+    uint8_t newest = NO_SOCKET_AVAIL;
+
+    if (WiFiDrv::hasCapability(CAP_ACCEPT_CLIENT)) {
+        // drain the backlog, whether the connections have data or not
+        for (int i = 0; i < WIFI_MAX_SOCK_NUM; i++) {
+            uint8_t sock = ServerDrv::acceptClient(_sock);
+
+            if (sock >= WIFI_MAX_SOCK_NUM) {
+                break;
+            }
+            if (!(_clients & (1 << sock))) {
+                enroll(sock);
+                newest = sock;
+            }
+        }
+        return newest;
+    }
+
+    // the module accepts connections by itself and reports the first
+    // client socket of this server that has unread data, so a client is
+    // only enrolled once it has sent data and no client ahead of it in
+    // the module's list still has unread data
+    uint8_t sock = ServerDrv::availServer(_sock);
+
+    if (sock >= WIFI_MAX_SOCK_NUM || (_clients & (1 << sock))) {
+        return NO_SOCKET_AVAIL;
+    }
+
+    enroll(sock);
+    return sock;
+}
+
 WiFiClient WiFiServer::available(byte* status)
 {
     int sock = NO_SOCKET_AVAIL;
 
     if (_sock != NO_SOCKET_AVAIL) {
-      // check previous received client socket
-      if (_lastSock != NO_SOCKET_AVAIL) {
-          WiFiClient client(_lastSock);
+      uint8_t accepted = accept();
+
+      // the module raises NINA_GPIO0 while a socket has unread data,
+      // only fetch from the sockets when it does
+      bool pending = SpiDrv::available();
+
+      // serve the clients in turn, starting after the last one checked
+      uint8_t start = (_lastSock < WIFI_MAX_SOCK_NUM) ? _lastSock + 1 : 0;
+      uint8_t checked = 0;
 
-          if (client.connected() && client.available()) {
-              sock = _lastSock;
+      for (int i = 0; i < WIFI_MAX_SOCK_NUM && checked < _budget; i++) {
+          uint8_t s = (start + i) % WIFI_MAX_SOCK_NUM;
+
+          if (!(_clients & (1 << s))) {
+              continue;
+          }
+          checked++;
+          _lastSock = s;
+
+          if (WiFiSocketBuffer.buffered(s) || (pending && WiFiSocketBuffer.available(s))) {
+              sock = s;
+              break;
+          }
+
+          if (isClosedState(ServerDrv::getClientState(s))) {
+              WiFiSocketBuffer.close(s);
+              _clients &= ~(1 << s);
           }
       }
 
       if (sock == NO_SOCKET_AVAIL) {
-          // check for new client socket
-          sock = ServerDrv::availServer(_sock);
+          sock = accepted;
       }
     }
 
@@ -80,6 +225,85 @@ WiFiClient WiFiServer::available(byte* status)
     return WiFiClient(255);
 }
 
+void WiFiServer::onAccept(WiFiServerAcceptCallback callback)
+{
+    _acceptCallback = callback;
+}
+
+void WiFiServer::onData(WiFiServerDataCallback callback)
+{
+    _dataCallback = callback;
+}
+
+void WiFiServer::onClose(WiFiServerCloseCallback callback)
+{
+    _closeCallback = callback;
+}
+
+void WiFiServer::poll(uint16_t ready, bool sweep)
+{
+    if (_sock == NO_SOCKET_AVAIL) {
+        return;
+    }
+
+    // NINA_GPIO0 only signals data, new connections without data are
+    // found by the sweep on firmware that can report them
+    if ((ready & (1 << _sock)) || (sweep && WiFiDrv::hasCapability(CAP_ACCEPT_CLIENT))) {
+        accept();
+    }
+
+    for (uint8_t sock = 0; sock < WIFI_MAX_SOCK_NUM; sock++) {
+        if (!(_clients & (1 << sock))) {
+            continue;
+        }
+
+        if (ready & (1 << sock)) {
+            WiFiClient client(sock);
+            int bytes = client.available();
+
+            if (bytes > 0) {
+                if (_dataCallback != NULL) {
+                    _dataCallback(client, bytes);
+                }
+                continue;
+            }
+        } else if (!sweep || WiFiSocketBuffer.buffered(sock)) {
+            continue;
+        }
+
+        // closes without data are only found by the sweep
+        if (isClosedState(ServerDrv::getClientState(sock))) {
+            WiFiSocketBuffer.close(sock);
+            _clients &= ~(1 << sock);
+
+            if (_closeCallback != NULL) {
+                _closeCallback(sock);
+            }
+        }
+    }
+}
+
+void WiFiServer::pollAll(uint16_t ready)
+{
+    if (_servers == NULL) {
+        return;
+    }
+
+    unsigned long now = millis();
+    bool sweep = (now - _lastSweep >= WIFI_SERVER_SWEEP_INTERVAL);
+
+    if (ready == 0 && !sweep) {
+        return;
+    }
+    if (sweep) {
+        _lastSweep = now;
+    }
+
+    for (WiFiServer* server = _servers; server != NULL; server = server->_nextServer) {
+        server->poll(ready, sweep);
+    }
+}
+
 uint8_t WiFiServer::status() {
     if (_sock == NO_SOCKET_AVAIL) {
         return CLOSED;
@@ -117,3 +341,54 @@ size_t WiFiServer::write(const uint8_t *buffer, size_t size)
 
     return written;
 }
+
+int WiFiServer::broadcast(const uint8_t *buffer, size_t size, uint8_t *results)
+{
+    uint8_t socks[WIFI_MAX_SOCK_NUM];
+    uint8_t sent[WIFI_MAX_SOCK_NUM];
+    uint8_t count = 0;
+    int clients = 0;
+
+    if (results != NULL)
+    {
+        memset(results, 0x00, WIFI_MAX_SOCK_NUM);
+    }
+
+    for (uint8_t sock = 0; sock < WIFI_MAX_SOCK_NUM; sock++)
+    {
+        if (_clients & (1 << sock))
+        {
+            socks[count++] = sock;
+        }
+    }
+
+    if (count == 0 || size == 0)
+    {
+        return 0;
+    }
+
+    if (WiFiDrv::hasCapability(CAP_SEND_DATA_MULTI))
+    {
+        // one transfer of the payload for all the clients
+        ServerDrv::sendDataMulti(socks, count, buffer, size, sent);
+    } else {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            sent[i] = (ServerDrv::sendData(socks[i], buffer, size) && ServerDrv::checkDataSent(socks[i]));
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (sent[i])
+        {
+            clients++;
+        }
+        if (results != NULL)
+        {
+            results[socks[i]] = sent[i];
+        }
+    }
+
+    return clients;
+}
@@ -27,22 +27,110 @@ extern "C" {
 
 #include "Server.h"
 
+// default number of client sockets checked for data by one call to available()
+#define WIFI_SERVER_DEF_SERVICE_BUDGET 2
+
+// interval of the sweep of WiFi.poll() for connections and closes without data
+#define WIFI_SERVER_SWEEP_INTERVAL 500
+
 class WiFiClient;
 
+typedef void (*WiFiServerAcceptCallback)(WiFiClient& client);
+typedef void (*WiFiServerDataCallback)(WiFiClient& client, int bytes);
+typedef void (*WiFiServerCloseCallback)(uint8_t sock);
+
 class WiFiServer : public Server {
 private:
   uint8_t _sock;
   uint8_t _lastSock;
   uint16_t _port;
   void*     pcb;
+  uint16_t _clients;  // bitmask of the sockets accepted by this server
+  uint8_t _budget;
+  WiFiServerAcceptCallback _acceptCallback;
+  WiFiServerDataCallback _dataCallback;
+  WiFiServerCloseCallback _closeCallback;
+
+  // servers started with begin(), dispatched by WiFi.poll()
+  static WiFiServer* _servers;
+  static unsigned long _lastSweep;
+  WiFiServer* _nextServer;
+
+  uint8_t accept();
+  void enroll(uint8_t sock);
+  void poll(uint16_t ready, bool sweep);
+  void restart();
 public:
   WiFiServer(uint16_t);
+  ~WiFiServer();
+
+  /*
+   * Return the next client with data available, serving the accepted
+   * clients in round-robin order. If no client has data, a newly accepted
+   * client is returned, if any.
+   *
+   * Firmware with CAP_ACCEPT_CLIENT reports every new connection. Older
+   * firmware only reports a new client once it has sent data, and only
+   * while no client ahead of it has unread data, so there a client that
+   * never sends is not accepted, and a new client may wait behind a busy one.
+   */
   WiFiClient available(uint8_t* status = NULL);
+
+  /*
+   * Set how many client sockets are checked for data by one call to available().
+   */
+  void setServiceBudget(uint8_t budget);
+
   void begin();
+
+  /*
+   * Send the data to all the clients of the server. The data is written to
+   * the listening socket and the module sends it to each of its clients,
+   * see broadcast() to send to the accepted clients only.
+   */
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
+
+  /*
+   * Send the data to every client accepted by available().
+   *
+   * param results: optional array of WIFI_MAX_SOCK_NUM entries, results[sock]
+   *                is set to 1 if the data was sent to the client on sock
+   * return: number of clients the data was sent to
+   */
+  int broadcast(const uint8_t *buf, size_t size, uint8_t *results = NULL);
   uint8_t status();
 
+  /*
+   * Event handlers invoked by WiFi.poll(): onAccept when a new client
+   * connects, onData when a client has bytes available and onClose when
+   * a client has disconnected. The data handler should read the
+   * available bytes, data left in the socket buffer is not reported again.
+   *
+   * NINA_GPIO0 only signals sockets with data, so connections and closes
+   * without data are found by a sweep of the socket states every
+   * WIFI_SERVER_SWEEP_INTERVAL ms. New connections without data are only
+   * reported on firmware with CAP_ACCEPT_CLIENT, older firmware reports
+   * them once they have sent data.
+   */
+  void onAccept(WiFiServerAcceptCallback callback);
+  void onData(WiFiServerDataCallback callback);
+  void onClose(WiFiServerCloseCallback callback);
+
+  /*
+   * Dispatch the events of all the started servers.
+   *
+   * param ready: bitmask of the sockets that have pending events, the
+   *              other sockets are only checked by the periodic sweep
+   */
+  static void pollAll(uint16_t ready);
+
+  /*
+   * Close the accepted clients and listen again on a new socket, for all
+   * the started servers. Used by WiFi.setAutoReconnect() after a reconnect.
+   */
+  static void restartAll();
+
   using Print::write;
 };
 
@@ -18,6 +18,7 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <stdlib.h>
 #include <string.h>
 
 extern "C" {
@@ -35,8 +36,45 @@ extern "C" {
 #include "WiFiServer.h"
 
 
+WiFiUDP* WiFiUDP::_udps = NULL;
+
 /* Constructor */
-WiFiUDP::WiFiUDP() : _sock(NO_SOCKET_AVAIL), _parsed(0) {}
+WiFiUDP::WiFiUDP() : _sock(NO_SOCKET_AVAIL), _parsed(0), _txBuffer(NULL), _txLength(0), _remotePort(0), _remoteValid(false),
+  _connectedPort(0), _connected(false), _armedPort(0), _armed(false), _started(false),
+  _destinationValid(false), _nextUdp(NULL)
+{
+  memset(_groups, 0x00, sizeof(_groups));
+}
+
+WiFiUDP::~WiFiUDP()
+{
+  unlink();
+
+  if (_txBuffer)
+  {
+    free(_txBuffer);
+  }
+}
+
+void WiFiUDP::link()
+{
+  unlink();
+  _nextUdp = _udps;
+  _udps = this;
+}
+
+void WiFiUDP::unlink()
+{
+  for (WiFiUDP** udp = &_udps; *udp != NULL; udp = &(*udp)->_nextUdp)
+  {
+    if (*udp == this)
+    {
+      *udp = _nextUdp;
+      break;
+    }
+  }
+  _nextUdp = NULL;
+}
 
 /* Start WiFiUDP socket, listening at local port PORT */
 uint8_t WiFiUDP::begin(uint16_t port) {
@@ -50,8 +88,14 @@ uint8_t WiFiUDP::begin(uint16_t port) {
     {
         ServerDrv::startServer(port, sock, UDP_MODE);
         _sock = sock;
+        _multicastIP = (uint32_t)0;
         _port = port;
         _parsed = 0;
+        _remoteValid = false;
+        _destinationValid = false;
+        _armed = false;
+        memset(_groups, 0x00, sizeof(_groups));
+        link();
         return 1;
     }
     return 0;
@@ -68,8 +112,14 @@ uint8_t WiFiUDP::beginMulticast(IPAddress ip, uint16_t port) {
     {
         ServerDrv::startServer(ip, port, sock, UDP_MULTICAST_MODE);
         _sock = sock;
+        _multicastIP = ip;
         _port = port;
         _parsed = 0;
+        _remoteValid = false;
+        _destinationValid = false;
+        _armed = false;
+        memset(_groups, 0x00, sizeof(_groups));
+        link();
         return 1;
     }
     return 0;
@@ -91,6 +141,93 @@ void WiFiUDP::stop()
 
 	  WiFiSocketBuffer.close(_sock);
 	  _sock = NO_SOCKET_AVAIL;
+	  unlink();
+	  memset(_groups, 0x00, sizeof(_groups));
+	  _remoteValid = false;
+	  _destinationValid = false;
+	  _armed = false;
+	  _connected = false;
+
+	  if (_txBuffer)
+	  {
+	    free(_txBuffer);
+	    _txBuffer = NULL;
+	  }
+	  _txLength = 0;
+}
+
+int WiFiUDP::joinGroup(IPAddress group)
+{
+	if (_sock == NO_SOCKET_AVAIL || !WiFiDrv::hasCapability(CAP_UDP_GROUPS))
+		return 0;
+
+	if (!ServerDrv::setUdpGroup(_sock, uint32_t(group), UDP_GROUP_JOIN))
+		return 0;
+
+	// remember the group to join it again after a reconnect
+	for (uint8_t i = 0; i < WIFI_UDP_MAX_GROUPS; i++)
+	{
+		if (_groups[i] == uint32_t(group))
+			break;
+		if (_groups[i] == 0)
+		{
+			_groups[i] = uint32_t(group);
+			break;
+		}
+	}
+	return 1;
+}
+
+int WiFiUDP::leaveGroup(IPAddress group)
+{
+	if (_sock == NO_SOCKET_AVAIL || !WiFiDrv::hasCapability(CAP_UDP_GROUPS))
+		return 0;
+
+	for (uint8_t i = 0; i < WIFI_UDP_MAX_GROUPS; i++)
+	{
+		if (_groups[i] == uint32_t(group))
+			_groups[i] = 0;
+	}
+
+	return ServerDrv::setUdpGroup(_sock, uint32_t(group), UDP_GROUP_LEAVE);
+}
+
+void WiFiUDP::restart()
+{
+	if (_sock != NO_SOCKET_AVAIL)
+	{
+		ServerDrv::stopClient(_sock);
+		WiFiSocketBuffer.close(_sock);
+	}
+
+	_parsed = 0;
+	_txLength = 0;
+	_remoteValid = false;
+	_destinationValid = false;
+	_armed = false;
+
+	_sock = ServerDrv::getSocket();
+	if (_sock == NO_SOCKET_AVAIL)
+		return;
+
+	if (uint32_t(_multicastIP) != 0)
+		ServerDrv::startServer(_multicastIP, _port, _sock, UDP_MULTICAST_MODE);
+	else
+		ServerDrv::startServer(_port, _sock, UDP_MODE);
+
+	for (uint8_t i = 0; i < WIFI_UDP_MAX_GROUPS; i++)
+	{
+		if (_groups[i] != 0)
+			ServerDrv::setUdpGroup(_sock, _groups[i], UDP_GROUP_JOIN);
+	}
+}
+
+void WiFiUDP::restartAll()
+{
+	for (WiFiUDP* udp = _udps; udp != NULL; udp = udp->_nextUdp)
+	{
+		udp->restart();
+	}
 }
 
 int WiFiUDP::beginPacket(const char *host, uint16_t port)
@@ -111,14 +248,69 @@ int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
 	  _sock = ServerDrv::getSocket();
   if (_sock != NO_SOCKET_AVAIL)
   {
-	  ServerDrv::startClient(uint32_t(ip), port, _sock, UDP_MODE);
+	  // the module keeps the destination between SEND_DATABUF_UDP_CMD commands,
+	  // set it up again only if it changed
+	  if (!_armed || uint32_t(ip) != uint32_t(_armedIP) || port != _armedPort ||
+	      !WiFiDrv::hasCapability(CAP_SEND_DATABUF_UDP))
+	  {
+	    ServerDrv::startClient(uint32_t(ip), port, _sock, UDP_MODE);
+	    _armedIP = ip;
+	    _armedPort = port;
+	    _armed = true;
+	    _started = true;
+	  } else {
+	    _started = false;
+	  }
+	  _txLength = 0;
 	  return 1;
   }
   return 0;
 }
 
+int WiFiUDP::beginPacket()
+{
+	if (!_connected)
+	{
+		return 0;
+	}
+	return beginPacket(_connectedIP, _connectedPort);
+}
+
+int WiFiUDP::connect(const char *host, uint16_t port)
+{
+	IPAddress remote_addr;
+	if (WiFi.hostByName(host, remote_addr))
+	{
+		return connect(remote_addr, port);
+	}
+	return 0;
+}
+
+int WiFiUDP::connect(IPAddress ip, uint16_t port)
+{
+	if (!beginPacket(ip, port))
+	{
+		return 0;
+	}
+	_connectedIP = ip;
+	_connectedPort = port;
+	_connected = true;
+	return 1;
+}
+
 int WiFiUDP::endPacket()
 {
+	if (_txLength != 0 && WiFiDrv::hasCapability(CAP_SEND_DATABUF_UDP))
+	{
+		// insert the payload and send it with a single command
+		bool sent = ServerDrv::sendUdpData(_sock, _txBuffer, _txLength);
+		_txLength = 0;
+		return sent;
+	}
+
+	flushTxBuffer();
+	// the destination is not relied on to survive SEND_DATA_UDP_CMD
+	_armed = false;
 	return ServerDrv::sendUdpData(_sock);
 }
 
@@ -129,25 +321,275 @@ size_t WiFiUDP::write(uint8_t byte)
 
 size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
 {
-	ServerDrv::insertDataBuf(_sock, buffer, size);
+	if (_txBuffer == NULL)
+	{
+		_txBuffer = (uint8_t*)malloc(WIFI_UDP_TX_BUFFER_SIZE);
+		_txLength = 0;
+	}
+
+	if (_txBuffer == NULL || size > WIFI_UDP_TX_BUFFER_SIZE)
+	{
+		// no buffer or too large to be worth copying, send it as is
+		flushTxBuffer();
+		insertTxData(buffer, size);
+		return size;
+	}
+
+	if (_txLength + size > WIFI_UDP_TX_BUFFER_SIZE)
+	{
+		flushTxBuffer();
+	}
+
+	memcpy(_txBuffer + _txLength, buffer, size);
+	_txLength += size;
 	return size;
 }
 
-int WiFiUDP::parsePacket()
+bool WiFiUDP::flushTxBuffer()
 {
-	while (_parsed--)
+	if (_txLength == 0)
 	{
-	  // discard previously parsed packet data
-	  uint8_t b;
+		return true;
+	}
+
+	bool result = insertTxData(_txBuffer, _txLength);
+	_txLength = 0;
+	return result;
+}
 
-	  WiFiSocketBuffer.read(_sock, &b, sizeof(b));
+bool WiFiUDP::insertTxData(const uint8_t* buffer, size_t size)
+{
+	// data inserted with INSERT_DATABUF_CMD needs the destination set up
+	// for the current packet, beginPacket() may have skipped it
+	if (!_started && _armed)
+	{
+		ServerDrv::startClient(uint32_t(_armedIP), _armedPort, _sock, UDP_MODE);
+		_started = true;
 	}
+	return ServerDrv::insertDataBuf(_sock, buffer, size);
+}
+
+int WiFiUDP::parsePacket()
+{
+	discardPacket();
 
 	_parsed = ServerDrv::availData(_sock);
+	if (_parsed > 0)
+	{
+		// the module shares the remote address between receive and send,
+		// a received datagram replaces the armed destination
+		_armed = false;
+	}
 
 	return _parsed;
 }
 
+void WiFiUDP::discardPacket()
+{
+	// discard previously parsed packet data
+	if (_parsed > 0)
+	{
+	  _parsed -= WiFiSocketBuffer.skip(_sock, _parsed);
+	}
+
+	if (_parsed > 0)
+	{
+	  if (WiFiDrv::hasCapability(CAP_DISCARD_DATA))
+	  {
+	    ServerDrv::discardData(_sock);
+	  } else {
+	    // fetch the rest in buffer sized chunks
+	    while (_parsed > 0 && WiFiSocketBuffer.available(_sock))
+	    {
+	      _parsed -= WiFiSocketBuffer.skip(_sock, _parsed);
+	    }
+	  }
+	}
+
+	_parsed = 0;
+	_remoteValid = false;
+	_destinationValid = false;
+}
+
+int WiFiUDP::receiveBatch(WiFiUDPDatagram* datagrams, uint8_t count)
+{
+	int received = 0;
+
+	if (_sock == NO_SOCKET_AVAIL)
+	{
+		return 0;
+	}
+
+	discardPacket();
+
+	if (WiFiDrv::hasCapability(CAP_GET_DATAGRAMS_UDP))
+	{
+		uint8_t headers[WIFI_UDP_MAX_BATCH][DATAGRAM_HEADER_LEN];
+		tDataParam params[WIFI_UDP_MAX_BATCH * 2];
+		uint16_t lengths[WIFI_UDP_MAX_BATCH * 2];
+
+		while (received < count)
+		{
+			uint8_t batch = count - received;
+			if (batch > WIFI_UDP_MAX_BATCH)
+			{
+				batch = WIFI_UDP_MAX_BATCH;
+			}
+
+			for (uint8_t i = 0; i < batch; i++)
+			{
+				params[i * 2].data = (char*)headers[i];
+				params[i * 2].dataLen = DATAGRAM_HEADER_LEN;
+				params[i * 2 + 1].data = (char*)datagrams[received + i].buffer;
+				params[i * 2 + 1].dataLen = datagrams[received + i].size;
+			}
+
+			uint8_t n = ServerDrv::getDatagrams(_sock, batch, params, lengths) / 2;
+
+			for (uint8_t i = 0; i < n; i++)
+			{
+				WiFiUDPDatagram* datagram = &datagrams[received + i];
+
+				datagram->remoteIP = headers[i];
+				datagram->remotePort = (headers[i][4] << 8) + headers[i][5];
+				datagram->length = lengths[i * 2 + 1];
+			}
+			received += n;
+			if (n > 0)
+			{
+				// the senders replaced the armed destination
+				_armed = false;
+			}
+
+			if (n < batch)
+			{
+				break;
+			}
+		}
+		return received;
+	}
+
+	while (received < count && parsePacket() > 0)
+	{
+		WiFiUDPDatagram* datagram = &datagrams[received++];
+
+		datagram->remoteIP = remoteIP();
+		datagram->remotePort = remotePort();
+		datagram->length = _parsed;
+
+		// read() returns at most one socket buffer chunk
+		uint16_t stored = 0;
+		while (stored < datagram->size)
+		{
+			int result = read(datagram->buffer + stored, datagram->size - stored);
+			if (result <= 0)
+			{
+				break;
+			}
+			stored += result;
+		}
+	}
+	discardPacket();
+
+	return received;
+}
+
+int WiFiUDP::sendBatch(const WiFiUDPDatagram* datagrams, uint8_t count, uint8_t* results)
+{
+	int sent = 0;
+
+	if (_sock == NO_SOCKET_AVAIL)
+	{
+		_sock = ServerDrv::getSocket();
+		if (_sock == NO_SOCKET_AVAIL)
+		{
+			if (results != NULL)
+			{
+				memset(results, 0x00, count);
+			}
+			return 0;
+		}
+	}
+
+	for (uint8_t done = 0; done < count; )
+	{
+		uint8_t batch = 0;
+		uint32_t bytes = 0;
+		uint8_t status[WIFI_UDP_MAX_BATCH];
+
+		while (batch < WIFI_UDP_MAX_BATCH && done + batch < count)
+		{
+			bytes += datagrams[done + batch].length;
+			if (bytes > WIFI_UDP_MAX_BATCH_BYTES)
+			{
+				break;
+			}
+			batch++;
+		}
+
+		// a datagram too large for a batch transfer is sent on its own
+		bool multi = (batch > 0);
+		if (!multi)
+		{
+			batch = 1;
+		}
+
+		if (multi && WiFiDrv::hasCapability(CAP_SEND_DATAGRAMS_UDP))
+		{
+			uint8_t headers[WIFI_UDP_MAX_BATCH][DATAGRAM_HEADER_LEN];
+			tDataParam params[WIFI_UDP_MAX_BATCH * 2];
+
+			for (uint8_t i = 0; i < batch; i++)
+			{
+				const WiFiUDPDatagram* datagram = &datagrams[done + i];
+
+				for (uint8_t j = 0; j < WL_IPV4_LENGTH; j++)
+				{
+					headers[i][j] = datagram->remoteIP[j];
+				}
+				headers[i][4] = datagram->remotePort >> 8;
+				headers[i][5] = datagram->remotePort & 0xff;
+
+				params[i * 2].data = (char*)headers[i];
+				params[i * 2].dataLen = DATAGRAM_HEADER_LEN;
+				params[i * 2 + 1].data = (char*)datagram->buffer;
+				params[i * 2 + 1].dataLen = datagram->length;
+			}
+
+			ServerDrv::sendDatagrams(_sock, batch, params, status);
+			// the module sent to other destinations
+			_armed = false;
+		} else {
+			for (uint8_t i = 0; i < batch; i++)
+			{
+				const WiFiUDPDatagram* datagram = &datagrams[done + i];
+
+				status[i] = 0;
+				if (beginPacket(datagram->remoteIP, datagram->remotePort))
+				{
+					write(datagram->buffer, datagram->length);
+					status[i] = endPacket();
+				}
+			}
+		}
+
+		for (uint8_t i = 0; i < batch; i++)
+		{
+			if (status[i])
+			{
+				sent++;
+			}
+			if (results != NULL)
+			{
+				results[done + i] = status[i];
+			}
+		}
+		done += batch;
+	}
+
+	return sent;
+}
+
 int WiFiUDP::read()
 {
   if (_parsed < 1)
@@ -195,23 +637,49 @@ void WiFiUDP::flush()
   // TODO: a real check to ensure transmission has been completed
 }
 
-IPAddress  WiFiUDP::remoteIP()
+void WiFiUDP::fetchRemoteData()
 {
+	if (_remoteValid)
+		return;
+
 	uint8_t _remoteIp[4] = {0};
-	uint8_t _remotePort[2] = {0};
+	uint8_t _remotePortBuf[2] = {0};
 
-	WiFiDrv::getRemoteData(_sock, _remoteIp, _remotePort);
-	IPAddress ip(_remoteIp);
-	return ip;
+	WiFiDrv::getRemoteData(_sock, _remoteIp, _remotePortBuf);
+	_remoteIP = _remoteIp;
+	_remotePort = (_remotePortBuf[0]<<8)+_remotePortBuf[1];
+	_remoteValid = true;
 }
 
-uint16_t  WiFiUDP::remotePort()
+IPAddress  WiFiUDP::remoteIP()
 {
-	uint8_t _remoteIp[4] = {0};
-	uint8_t _remotePort[2] = {0};
+	fetchRemoteData();
+	return _remoteIP;
+}
 
-	WiFiDrv::getRemoteData(_sock, _remoteIp, _remotePort);
-	uint16_t port = (_remotePort[0]<<8)+_remotePort[1];
-	return port;
+uint16_t  WiFiUDP::remotePort()
+{
+	fetchRemoteData();
+	return _remotePort;
 }
 
+IPAddress  WiFiUDP::destinationIP()
+{
+	if (!WiFiDrv::hasCapability(CAP_UDP_GROUPS))
+	{
+		// only the group of beginMulticast() can be reported
+		if (uint32_t(_multicastIP) != 0)
+			return _multicastIP;
+		return WiFi.localIP();
+	}
+
+	if (!_destinationValid)
+	{
+		uint8_t _destIp[4] = {0};
+
+		WiFiDrv::getDestinationData(_sock, _destIp);
+		_destinationIP = _destIp;
+		_destinationValid = true;
+	}
+	return _destinationIP;
+}
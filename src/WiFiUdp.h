@@ -25,18 +25,87 @@
 
 #define UDP_TX_PACKET_MAX_SIZE 24
 
+// size of the buffer used to assemble outgoing datagrams
+#ifdef __AVR__
+#define WIFI_UDP_TX_BUFFER_SIZE 64
+#else
+#define WIFI_UDP_TX_BUFFER_SIZE 512
+#endif
+
+// maximum number of datagrams moved by one batch transfer
+#define WIFI_UDP_MAX_BATCH 8
+
+// maximum number of payload bytes sent by one batch transfer, keeps the
+// command within the SPI receive buffer of the module
+#define WIFI_UDP_MAX_BATCH_BYTES 4000
+
+// number of multicast groups joined with joinGroup() restored after a reconnect
+#ifdef __AVR__
+#define WIFI_UDP_MAX_GROUPS 2
+#else
+#define WIFI_UDP_MAX_GROUPS 4
+#endif
+
+// descriptor of a datagram for WiFiUDP::receiveBatch() and sendBatch()
+typedef struct {
+  IPAddress remoteIP;
+  uint16_t remotePort;
+  uint8_t* buffer;   // payload
+  uint16_t size;     // size of buffer, not used by sendBatch()
+  uint16_t length;   // length of the payload, receiveBatch() stores at most size bytes of it
+} WiFiUDPDatagram;
+
 class WiFiUDP : public UDP {
 private:
   uint8_t _sock;  // socket ID for Wiz5100
   uint16_t _port; // local port to listen on
   int _parsed;
+  uint8_t* _txBuffer;
+  uint16_t _txLength;
+  IPAddress _remoteIP;
+  uint16_t _remotePort;
+  bool _remoteValid; // _remoteIP and _remotePort belong to the current packet
+  IPAddress _connectedIP;
+  uint16_t _connectedPort;
+  bool _connected;   // a default destination was set with connect()
+  IPAddress _armedIP;
+  uint16_t _armedPort;
+  bool _armed;       // _armedIP and _armedPort are set up in the module
+  bool _started;     // START_CLIENT_TCP_CMD was sent for the current packet
+  IPAddress _multicastIP; // group of beginMulticast()
+  IPAddress _destinationIP;
+  bool _destinationValid; // _destinationIP belongs to the current packet
+  uint32_t _groups[WIFI_UDP_MAX_GROUPS]; // groups joined with joinGroup(), 0 if unused
+
+  // sockets started with begin() or beginMulticast(), restored by restartAll()
+  static WiFiUDP* _udps;
+  WiFiUDP* _nextUdp;
+
+  void link();
+  void unlink();
+  void restart();
+
+  bool flushTxBuffer();
+  bool insertTxData(const uint8_t* buffer, size_t size);
+  void discardPacket();
+  void fetchRemoteData();
+
+  // not copyable, the instance owns _txBuffer and is linked in _udps
+  WiFiUDP(const WiFiUDP&);
+  WiFiUDP& operator=(const WiFiUDP&);
 
 public:
   WiFiUDP();  // Constructor
+  ~WiFiUDP();
   virtual uint8_t begin(uint16_t);	// initialize, start listening on specified port. Returns 1 if successful, 0 if there are no sockets available to use
   virtual uint8_t beginMulticast(IPAddress, uint16_t);  // initialize, start listening on specified multicast IP address and port. Returns 1 if successful, 0 if there are no sockets available to use
   virtual void stop();  // Finish with the UDP socket
 
+  // Add or remove a multicast group membership on the socket started with begin() or beginMulticast()
+  // Returns 1 if successful, 0 if there is no socket or the firmware does not support it
+  int joinGroup(IPAddress group);
+  int leaveGroup(IPAddress group);
+
   // Sending UDP packets
   
   // Start building up a packet to send to the remote host specific in ip and port
@@ -45,10 +114,19 @@ public:
   // Start building up a packet to send to the remote host specific in host and port
   // Returns 1 if successful, 0 if there was a problem resolving the hostname or port
   virtual int beginPacket(const char *host, uint16_t port);
+  // Set the default destination of the packets started with beginPacket()
+  // Returns 1 if successful, 0 if there are no sockets available to use
+  int connect(IPAddress ip, uint16_t port);
+  // Returns 1 if successful, 0 if there was a problem resolving the hostname
+  int connect(const char *host, uint16_t port);
+  // Start building up a packet to send to the destination set with connect()
+  // Returns 1 if successful, 0 if connect() was not called
+  int beginPacket();
   // Finish off this packet and send it
   // Returns 1 if the packet was sent successfully, 0 if there was an error
   virtual int endPacket();
   // Write a single byte into the packet
+  // The packet is assembled locally and transferred to the module by endPacket()
   virtual size_t write(uint8_t);
   // Write size bytes from buffer into the packet
   virtual size_t write(const uint8_t *buffer, size_t size);
@@ -72,10 +150,29 @@ public:
   virtual int peek();
   virtual void flush();	// Finish reading the current packet
 
+  // Receive up to count queued datagrams, with their sender, into the caller provided
+  // descriptors. The buffer and size fields must be set, payloads longer than size are truncated
+  // and keep their full length in the length field, so length > size flags a truncated datagram.
+  // The current packet is discarded. Returns the number of datagrams received
+  int receiveBatch(WiFiUDPDatagram* datagrams, uint8_t count);
+
+  // Send count datagrams to their remoteIP and remotePort. If results is not NULL,
+  // results[i] is set to 1 if datagram i was sent. Returns the number of datagrams sent
+  // A transfer carries at most WIFI_UDP_MAX_BATCH datagrams and WIFI_UDP_MAX_BATCH_BYTES payload bytes
+  int sendBatch(const WiFiUDPDatagram* datagrams, uint8_t count, uint8_t* results = NULL);
+
   // Return the IP address of the host who sent the current incoming packet
+  // The sender is fetched from the module once per packet
   virtual IPAddress remoteIP();
   // Return the port of the host who sent the current incoming packet
   virtual uint16_t remotePort();
+  // Return the destination address of the current incoming packet, the multicast group
+  // it was sent to or the local address
+  IPAddress destinationIP();
+
+  // Start again all the sockets started with begin() or beginMulticast(), with their
+  // multicast groups. Used by WiFi.setAutoReconnect() after a reconnect
+  static void restartAll();
 
   friend class WiFiDrv;
 };
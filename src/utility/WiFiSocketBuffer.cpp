@@ -73,6 +73,11 @@ int WiFiSocketBufferClass::available(int socket)
   return _buffers[socket].length;
 }
 
+int WiFiSocketBufferClass::buffered(int socket)
+{
+  return _buffers[socket].length;
+}
+
 int WiFiSocketBufferClass::peek(int socket)
 {
   if (!available(socket)) {
@@ -101,4 +106,16 @@ int WiFiSocketBufferClass::read(int socket, uint8_t* data, size_t length)
   return length;
 }
 
+int WiFiSocketBufferClass::skip(int socket, size_t length)
+{
+  if (_buffers[socket].length < (int)length) {
+    length = _buffers[socket].length;
+  }
+
+  _buffers[socket].head += length;
+  _buffers[socket].length -= length;
+
+  return length;
+}
+
 WiFiSocketBufferClass WiFiSocketBuffer;
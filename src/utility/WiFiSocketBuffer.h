@@ -39,6 +39,12 @@ public:
   int peek(int socket);
   int read(int socket, uint8_t* data, size_t length);
 
+  // drop up to length bytes already buffered, without fetching more data
+  int skip(int socket, size_t length);
+
+  // number of bytes already buffered, without fetching more data
+  int buffered(int socket);
+
 private:
   struct {
     uint8_t* data;
@@ -24,6 +24,7 @@
 
 #include "Arduino.h"
 #include "utility/spi_drv.h"
+#include "utility/wifi_drv.h"
 
 extern "C" {
 #include "utility/wl_types.h"
@@ -143,6 +144,41 @@ void ServerDrv::startClient(const char* host, uint8_t host_len, uint32_t ipAddre
     SpiDrv::spiSlaveDeselect();  
 }
 
+bool ServerDrv::startClientAsync(const char* host, uint8_t host_len, uint32_t ipAddress, uint16_t port, uint8_t sock, uint8_t protMode)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(START_CLIENT_ASYNC_CMD, PARAM_NUMS_5);
+    SpiDrv::sendParam((uint8_t*)host, host_len);
+    SpiDrv::sendParam((uint8_t*)&ipAddress, sizeof(ipAddress));
+    SpiDrv::sendParam(port);
+    SpiDrv::sendParam(&sock, 1);
+    SpiDrv::sendParam(&protMode, 1, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 17 + host_len;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(START_CLIENT_ASYNC_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_dataLen != 0 && _data == 1);
+}
+
 // Start server TCP on port specified
 void ServerDrv::stopClient(uint8_t sock)
 {
@@ -170,6 +206,33 @@ void ServerDrv::stopClient(uint8_t sock)
     SpiDrv::spiSlaveDeselect();
 }
 
+// Close the socket with a RST, without a graceful shutdown
+void ServerDrv::abortClient(uint8_t sock)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(ABORT_CLIENT_TCP_CMD, PARAM_NUMS_1);
+    SpiDrv::sendParam(&sock, 1, LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(ABORT_CLIENT_TCP_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+}
+
 
 uint8_t ServerDrv::getServerState(uint8_t sock)
 {
@@ -256,6 +319,34 @@ uint16_t ServerDrv::availData(uint8_t sock)
     return len;
 }
 
+uint8_t ServerDrv::acceptClient(uint8_t sock)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(ACCEPT_CLIENT_TCP_CMD, PARAM_NUMS_1);
+    SpiDrv::sendParam(&sock, sizeof(sock), LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = NO_SOCKET_AVAIL;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(ACCEPT_CLIENT_TCP_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_dataLen != 0) ? _data : NO_SOCKET_AVAIL;
+}
+
 uint8_t ServerDrv::availServer(uint8_t sock)
 {
     if (!SpiDrv::available()) {
@@ -350,6 +441,134 @@ bool ServerDrv::getDataBuf(uint8_t sock, uint8_t *_data, uint16_t *_dataLen)
     return false;
 }
 
+bool ServerDrv::discardData(uint8_t sock)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(DISCARD_DATA_CMD, PARAM_NUMS_1);
+    SpiDrv::sendParam(&sock, sizeof(sock), LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(DISCARD_DATA_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_data == 1);
+}
+
+bool ServerDrv::setUdpGroup(uint8_t sock, uint32_t groupAddress, uint8_t action)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(SET_UDP_GROUP_CMD, PARAM_NUMS_3);
+    SpiDrv::sendParam(&sock, sizeof(sock));
+    SpiDrv::sendParam((uint8_t*)&groupAddress, sizeof(groupAddress));
+    SpiDrv::sendParam(&action, sizeof(action), LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(SET_UDP_GROUP_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_data == 1);
+}
+
+uint8_t ServerDrv::getDatagrams(uint8_t sock, uint8_t count, tDataParam *params, uint16_t *lengths)
+{
+    if (!SpiDrv::available()) {
+        return 0;
+    }
+
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(GET_DATAGRAMS_UDP_CMD, PARAM_NUMS_2);
+    SpiDrv::sendBuffer(&sock, sizeof(sock));
+    SpiDrv::sendBuffer(&count, sizeof(count), LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t numParams = 0;
+    if (!SpiDrv::waitResponseParams16(GET_DATAGRAMS_UDP_CMD, &numParams, params, count * 2, lengths))
+    {
+        WARN("error waitResponse");
+        numParams = 0;
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return numParams;
+}
+
+bool ServerDrv::sendDatagrams(uint8_t sock, uint8_t count, const tDataParam *params, uint8_t *results)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(SEND_DATAGRAMS_UDP_CMD, 1 + count * 2);
+    SpiDrv::sendBuffer(&sock, sizeof(sock), (count == 0) ? LAST_PARAM : NO_LAST_PARAM);
+
+    int commandSize = 7;
+    for (uint8_t i = 0; i < count * 2; i++) {
+        SpiDrv::sendBuffer((uint8_t *)params[i].data, params[i].dataLen, (i == count * 2 - 1) ? LAST_PARAM : NO_LAST_PARAM);
+        commandSize += 2 + params[i].dataLen;
+    }
+
+    // pad to multiple of 4
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _dataLen = 0;
+    memset(results, 0x00, count);
+    if (!SpiDrv::waitResponseData8(SEND_DATAGRAMS_UDP_CMD, results, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_dataLen == count);
+}
+
 bool ServerDrv::insertDataBuf(uint8_t sock, const uint8_t *data, uint16_t _len)
 {
 	WAIT_FOR_SLAVE_SELECT();
@@ -416,6 +635,40 @@ bool ServerDrv::sendUdpData(uint8_t sock)
     return false;
 }
 
+bool ServerDrv::sendUdpData(uint8_t sock, const uint8_t *data, uint16_t len)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(SEND_DATABUF_UDP_CMD, PARAM_NUMS_2);
+    SpiDrv::sendBuffer(&sock, sizeof(sock));
+    SpiDrv::sendBuffer((uint8_t *)data, len, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 9 + len;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseData8(SEND_DATABUF_UDP_CMD, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+    if (_dataLen!=0)
+    {
+        return (_data == 1);
+    }
+    return false;
+}
 
 uint16_t ServerDrv::sendData(uint8_t sock, const uint8_t *data, uint16_t len)
 {
@@ -449,6 +702,38 @@ uint16_t ServerDrv::sendData(uint8_t sock, const uint8_t *data, uint16_t len)
     return _data;
 }
 
+// Send the same data to several sockets, results[i] is 1 if it was sent on socks[i]
+bool ServerDrv::sendDataMulti(const uint8_t *socks, uint8_t count, const uint8_t *data, uint16_t len, uint8_t *results)
+{
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(SEND_DATA_MULTI_TCP_CMD, PARAM_NUMS_2);
+    SpiDrv::sendBuffer((uint8_t *)socks, count);
+    SpiDrv::sendBuffer((uint8_t *)data, len, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 8 + count + len;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _dataLen = 0;
+    memset(results, 0x00, count);
+    if (!SpiDrv::waitResponseData8(SEND_DATA_MULTI_TCP_CMD, results, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_dataLen == count);
+}
 
 uint8_t ServerDrv::checkDataSent(uint8_t sock)
 {
@@ -489,6 +774,40 @@ uint8_t ServerDrv::checkDataSent(uint8_t sock)
     return (timeout==TIMEOUT_DATA_SENT)?0:1;
 }
 
+uint16_t ServerDrv::getSocketsReady()
+{
+    if (!SpiDrv::available()) {
+        return 0;
+    }
+
+    if (!WiFiDrv::hasCapability(CAP_SOCKETS_READY)) {
+        return 0xFFFF;
+    }
+
+    WAIT_FOR_SLAVE_SELECT();
+
+    // Send Command
+    SpiDrv::sendCmd(GET_SOCKETS_READY_CMD, PARAM_NUMS_0);
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint16_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(GET_SOCKETS_READY_CMD, PARAM_NUMS_1, (uint8_t*)&_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+        _data = 0xFFFF;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+
+    return _data;
+}
+
 uint8_t ServerDrv::getSocket()
 {
     WAIT_FOR_SLAVE_SELECT();
@@ -22,6 +22,7 @@
 #define Server_Drv_h
 
 #include <inttypes.h>
+#include <stddef.h>
 #include "utility/wifi_spi.h"
 
 typedef enum eProtMode {TCP_MODE, UDP_MODE, TLS_MODE, UDP_MULTICAST_MODE}tProtMode;
@@ -39,7 +40,18 @@ public:
 
     static void startClient(const char* host, uint8_t host_len, uint32_t ipAddress, uint16_t port, uint8_t sock, uint8_t protMode=TCP_MODE);
 
+    /*
+     * Start a client connection with START_CLIENT_ASYNC_CMD, the module
+     * replies at once and resolves host, if not empty, connects and does
+     * the TLS handshake in the background. getClientState() reports
+     * SYN_SENT until the connection is established or has failed.
+     * return: true if the connection was started
+     */
+    static bool startClientAsync(const char* host, uint8_t host_len, uint32_t ipAddress, uint16_t port, uint8_t sock, uint8_t protMode=TCP_MODE);
+
     static void stopClient(uint8_t sock);
+
+    static void abortClient(uint8_t sock);
                                                                                   
     static uint8_t getServerState(uint8_t sock);
 
@@ -49,18 +61,59 @@ public:
 
     static bool getDataBuf(uint8_t sock, uint8_t *data, uint16_t *len);
 
+    // drop the unread data of the current datagram on the module
+    static bool discardData(uint8_t sock);
+
+    // join (UDP_GROUP_JOIN) or leave (UDP_GROUP_LEAVE) a multicast group on a UDP socket
+    static bool setUdpGroup(uint8_t sock, uint32_t groupAddress, uint8_t action);
+
+    /*
+     * Fetch up to count queued datagrams in one transfer. Each datagram
+     * fills two params: a DATAGRAM_HEADER_LEN bytes header and the payload.
+     * lengths, if given, has count * 2 entries set to the untruncated
+     * length of each param.
+     * return: number of params filled
+     */
+    static uint8_t getDatagrams(uint8_t sock, uint8_t count, tDataParam *params, uint16_t *lengths = NULL);
+
+    /*
+     * Send count datagrams in one transfer, described by the same header
+     * and payload params pairs of getDatagrams().
+     * results[i] is set to 1 if the datagram i was sent
+     */
+    static bool sendDatagrams(uint8_t sock, uint8_t count, const tDataParam *params, uint8_t *results);
+
     static bool insertDataBuf(uint8_t sock, const uint8_t *_data, uint16_t _dataLen);
 
     static uint16_t sendData(uint8_t sock, const uint8_t *data, uint16_t len);
 
+    static bool sendDataMulti(const uint8_t *socks, uint8_t count, const uint8_t *data, uint16_t len, uint8_t *results);
+
     static bool sendUdpData(uint8_t sock);
 
+    // insert the data and send the datagram in one command
+    static bool sendUdpData(uint8_t sock, const uint8_t *data, uint16_t len);
+
     static uint16_t availData(uint8_t sock);
 
     static uint8_t availServer(uint8_t sock);
 
+    /*
+     * Get the next connection accepted by the server on sock that was not
+     * reported yet, whether it has data or not, with ACCEPT_CLIENT_TCP_CMD.
+     * return: socket of the connection, NO_SOCKET_AVAIL if there is none
+     */
+    static uint8_t acceptClient(uint8_t sock);
+
     static uint8_t checkDataSent(uint8_t sock);
 
+    /*
+     * Get the sockets with pending events (data, new connection or close).
+     * Nothing is queried while NINA_GPIO0 reports no pending event.
+     * return: bitmask of the sockets, all set if the firmware has no CAP_SOCKETS_READY
+     */
+    static uint16_t getSocketsReady();
+
     static uint8_t getSocket();
 };
 
@@ -297,6 +297,94 @@ int SpiDrv::waitResponseData16(uint8_t cmd, uint8_t* param, uint16_t* param_len)
     return 1;
 }
 
+// params[i].dataLen is the size of params[i].data on input and the number of
+// bytes stored on output, longer params and params beyond maxNumParams are dropped,
+// paramLens[i], if given, is set to the length of param i sent by the module
+int SpiDrv::waitResponseParams16(uint8_t cmd, uint8_t* numParamRead, tDataParam* params, uint8_t maxNumParams, uint16_t* paramLens)
+{
+    char _data = 0;
+    int i = 0;
+    uint16_t ii = 0;
+
+    IF_CHECK_START_CMD(_data)
+    {
+        CHECK_DATA(cmd | REPLY_FLAG, _data){};
+
+        uint8_t numParam = readChar();
+
+        *numParamRead = (numParam > maxNumParams) ? maxNumParams : numParam;
+        for (i=0; i<numParam; ++i)
+        {
+            uint16_t paramLen = readParamLen16();
+            uint16_t size = 0;
+
+            if (i < maxNumParams)
+            {
+                size = (paramLen < params[i].dataLen) ? paramLen : params[i].dataLen;
+                params[i].dataLen = size;
+                if (paramLens != NULL)
+                {
+                    paramLens[i] = paramLen;
+                }
+            }
+            for (ii=0; ii<paramLen; ++ii)
+            {
+                // Get Params data
+                char c = spiTransfer(DUMMY_DATA);
+                if (ii < size)
+                {
+                    params[i].data[ii] = c;
+                }
+            }
+        }
+
+        readAndCheckChar(END_CMD, &_data);
+    }
+
+    return 1;
+}
+
+// params[i].paramLen is the size of params[i].param on input and the number of
+// bytes stored on output, longer params and params beyond maxNumParams are dropped
+int SpiDrv::waitResponseParams8(uint8_t cmd, uint8_t* numParamRead, tParam* params, uint8_t maxNumParams)
+{
+    char _data = 0;
+    int i = 0, ii = 0;
+
+    IF_CHECK_START_CMD(_data)
+    {
+        CHECK_DATA(cmd | REPLY_FLAG, _data){};
+
+        uint8_t numParam = readChar();
+
+        *numParamRead = (numParam > maxNumParams) ? maxNumParams : numParam;
+        for (i=0; i<numParam; ++i)
+        {
+            uint8_t paramLen = readParamLen8();
+            uint8_t size = 0;
+
+            if (i < maxNumParams)
+            {
+                size = (paramLen < params[i].paramLen) ? paramLen : params[i].paramLen;
+                params[i].paramLen = size;
+            }
+            for (ii=0; ii<paramLen; ++ii)
+            {
+                // Get Params data
+                char c = spiTransfer(DUMMY_DATA);
+                if (ii < size)
+                {
+                    params[i].param[ii] = c;
+                }
+            }
+        }
+
+        readAndCheckChar(END_CMD, &_data);
+    }
+
+    return 1;
+}
+
 int SpiDrv::waitResponseData8(uint8_t cmd, uint8_t* param, uint8_t* param_len)
 {
     char _data = 0;
@@ -403,40 +491,39 @@ int SpiDrv::waitResponse(uint8_t cmd, tParam* params, uint8_t* numParamRead, uin
 }
 */
 
+// params is an array of maxNumParams strings of WL_SSID_MAX_LENGTH + 1 chars,
+// longer params are truncated and params beyond maxNumParams are dropped
 int SpiDrv::waitResponse(uint8_t cmd, uint8_t* numParamRead, uint8_t** params, uint8_t maxNumParams)
 {
     char _data = 0;
     int i =0, ii = 0;
 
-    char    *index[WL_SSID_MAX_LENGTH];
-
-    for (i = 0 ; i < WL_NETWORKS_LIST_MAXNUM ; i++)
-            index[i] = (char *)params + WL_SSID_MAX_LENGTH*i;
-
     IF_CHECK_START_CMD(_data)
     {
         CHECK_DATA(cmd | REPLY_FLAG, _data){};
 
         uint8_t numParam = readChar();
 
-        if (numParam > maxNumParams)
-        {
-            numParam = maxNumParams;
-        }
-        *numParamRead = numParam;
+        *numParamRead = (numParam > maxNumParams) ? maxNumParams : numParam;
         if (numParam != 0)
         {
             for (i=0; i<numParam; ++i)
             {
-            	uint8_t paramLen = readParamLen8();
+                char* index = (char *)params + (WL_SSID_MAX_LENGTH + 1)*i;
+                uint8_t paramLen = readParamLen8();
                 for (ii=0; ii<paramLen; ++ii)
                 {
-                	//ssid[ii] = spiTransfer(DUMMY_DATA);
                     // Get Params data
-                    index[i][ii] = (uint8_t)spiTransfer(DUMMY_DATA);
-
+                    char c = spiTransfer(DUMMY_DATA);
+                    if (i < maxNumParams && ii < WL_SSID_MAX_LENGTH)
+                    {
+                        index[ii] = c;
+                    }
+                }
+                if (i < maxNumParams)
+                {
+                    index[(ii < WL_SSID_MAX_LENGTH) ? ii : WL_SSID_MAX_LENGTH] = 0;
                 }
-                index[i][ii]=0;
             }
         } else
         {
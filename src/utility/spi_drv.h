@@ -76,6 +76,10 @@ public:
     static int waitResponseData8(uint8_t cmd, uint8_t* param, uint8_t* param_len);
      
     static int waitResponseData16(uint8_t cmd, uint8_t* param, uint16_t* param_len);
+
+    static int waitResponseParams16(uint8_t cmd, uint8_t* numParamRead, tDataParam* params, uint8_t maxNumParams, uint16_t* paramLens = NULL);
+
+    static int waitResponseParams8(uint8_t cmd, uint8_t* numParamRead, tParam* params, uint8_t maxNumParams);
  /*
     static int waitResponse(uint8_t cmd, tParam* params, uint8_t* numParamRead, uint8_t maxNumParams);
     
@@ -25,6 +25,8 @@
 #include "Arduino.h"
 #include "utility/spi_drv.h"
 #include "utility/wifi_drv.h"
+#include "utility/wifi_pmk.h"
+#include "WiFi.h"
 
 #define _DEBUG_
 
@@ -35,7 +37,7 @@ extern "C" {
 }
 
 // Array of data to cache the information related to the networks discovered
-char 	WiFiDrv::_networkSsid[][WL_SSID_MAX_LENGTH] = {{"1"},{"2"},{"3"},{"4"},{"5"}};
+char 	WiFiDrv::_networkSsid[][WL_SSID_MAX_LENGTH + 1] = {{"1"},{"2"},{"3"},{"4"},{"5"}};
 
 // Cached values of retrieved data
 char 	WiFiDrv::_ssid[] = {0};
@@ -46,6 +48,23 @@ uint8_t WiFiDrv::_subnetMask[] = {0};
 uint8_t WiFiDrv::_gatewayIp[] = {0};
 // Firmware version
 char    WiFiDrv::fwVersion[] = {0};
+// Validity of the cached values, the network data is fetched again after a
+// change of the connection status or of the configuration
+bool    WiFiDrv::_networkDataValid = false;
+bool    WiFiDrv::_macValid = false;
+bool    WiFiDrv::_fwVersionValid = false;
+uint8_t WiFiDrv::_connectionStatus = WL_NO_SHIELD;
+// Time of the change of the connection status to WL_CONNECTED
+unsigned long WiFiDrv::_connectedSince = 0;
+// Host name cache
+tDnsCacheEntry WiFiDrv::_dnsCache[WL_DNS_CACHE_SIZE];
+unsigned long WiFiDrv::_dnsCacheTtl = WL_DNS_CACHE_DEF_TTL;
+unsigned long WiFiDrv::_dnsCacheNegativeTtl = WL_DNS_CACHE_DEF_NEG_TTL;
+// Queue of asynchronous host name lookups
+tDnsRequest WiFiDrv::_dnsQueue[WL_DNS_QUEUE_SIZE];
+// Firmware capabilities
+uint32_t WiFiDrv::_capabilities = 0;
+bool    WiFiDrv::_capabilitiesValid = false;
 
 
 // Private Methods
@@ -102,6 +121,31 @@ void WiFiDrv::getRemoteData(uint8_t sock, uint8_t *ip, uint8_t *port)
     SpiDrv::spiSlaveDeselect();
 }
 
+void WiFiDrv::getDestinationData(uint8_t sock, uint8_t *ip)
+{
+    tParam params[PARAM_NUMS_1] = { {0, (char*)ip} };
+
+    WAIT_FOR_SLAVE_SELECT();
+
+    // Send Command
+    SpiDrv::sendCmd(GET_DEST_DATA_CMD, PARAM_NUMS_1);
+    SpiDrv::sendParam(&sock, sizeof(sock), LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    SpiDrv::waitResponseParams(GET_DEST_DATA_CMD, PARAM_NUMS_1, params);
+
+    SpiDrv::spiSlaveDeselect();
+}
+
 
 // Public Methods
 
@@ -109,15 +153,25 @@ void WiFiDrv::getRemoteData(uint8_t sock, uint8_t *ip, uint8_t *port)
 void WiFiDrv::wifiDriverInit()
 {
     SpiDrv::begin();
+    _capabilitiesValid = false;
+    _networkDataValid = false;
+    _macValid = false;
+    _fwVersionValid = false;
 }
 
 void WiFiDrv::wifiDriverDeinit()
 {
     SpiDrv::end();
+    _capabilitiesValid = false;
+    _networkDataValid = false;
+    _macValid = false;
+    _fwVersionValid = false;
 }
 
 int8_t WiFiDrv::wifiSetNetwork(const char* ssid, uint8_t ssid_len)
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_NET_CMD, PARAM_NUMS_1);
@@ -150,6 +204,8 @@ int8_t WiFiDrv::wifiSetNetwork(const char* ssid, uint8_t ssid_len)
 
 int8_t WiFiDrv::wifiSetPassphrase(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len)
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_PASSPHRASE_CMD, PARAM_NUMS_2);
@@ -181,8 +237,89 @@ int8_t WiFiDrv::wifiSetPassphrase(const char* ssid, uint8_t ssid_len, const char
 }
 
 
+int8_t WiFiDrv::wifiSetPassphraseBssid(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len,
+                                       const uint8_t* bssid, uint8_t channel)
+{
+	_networkDataValid = false;
+
+	if (!hasCapability(CAP_BSSID_CONNECT))
+	{
+		if (len == 0)
+			return wifiSetNetwork(ssid, ssid_len);
+		return wifiSetPassphrase(ssid, ssid_len, passphrase, len);
+	}
+
+	WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(SET_PASSPHRASE_BSSID_CMD, PARAM_NUMS_4);
+    SpiDrv::sendParam((uint8_t*)ssid, ssid_len, NO_LAST_PARAM);
+    SpiDrv::sendParam((uint8_t*)passphrase, len, NO_LAST_PARAM);
+    SpiDrv::sendParam((uint8_t*)bssid, WL_MAC_ADDR_LENGTH, NO_LAST_PARAM);
+    SpiDrv::sendParam(&channel, 1, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 15 + ssid_len + len;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(SET_PASSPHRASE_BSSID_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+        _data = WL_FAILURE;
+    }
+    SpiDrv::spiSlaveDeselect();
+    return _data;
+}
+
+
+int8_t WiFiDrv::getPmk(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len, uint8_t* pmk)
+{
+	if (!hasCapability(CAP_DERIVE_PMK))
+		return WL_FAILURE;
+
+	WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(DERIVE_PMK_CMD, PARAM_NUMS_2);
+    SpiDrv::sendParam((uint8_t*)ssid, ssid_len, NO_LAST_PARAM);
+    SpiDrv::sendParam((uint8_t*)passphrase, len, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 6 + ssid_len + len;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(DERIVE_PMK_CMD, PARAM_NUMS_1, pmk, &_dataLen))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return (_dataLen == WL_PMK_LENGTH) ? WL_SUCCESS : WL_FAILURE;
+}
+
 int8_t WiFiDrv::wifiSetKey(const char* ssid, uint8_t ssid_len, uint8_t key_idx, const void *key, const uint8_t len)
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_KEY_CMD, PARAM_NUMS_3);
@@ -216,6 +353,8 @@ int8_t WiFiDrv::wifiSetKey(const char* ssid, uint8_t ssid_len, uint8_t key_idx,
 
 void WiFiDrv::config(uint8_t validParams, uint32_t local_ip, uint32_t gateway, uint32_t subnet)
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_IP_CONFIG_CMD, PARAM_NUMS_4);
@@ -247,6 +386,8 @@ void WiFiDrv::config(uint8_t validParams, uint32_t local_ip, uint32_t gateway, u
 
 void WiFiDrv::setDNS(uint8_t validParams, uint32_t dns_server1, uint32_t dns_server2)
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_DNS_CONFIG_CMD, PARAM_NUMS_3);
@@ -268,6 +409,9 @@ void WiFiDrv::setDNS(uint8_t validParams, uint32_t dns_server1, uint32_t dns_ser
         _data = WL_FAILURE;
     }
     SpiDrv::spiSlaveDeselect();
+
+    // names may resolve differently with the new servers
+    flushDnsCache();
 }
 
 void WiFiDrv::setHostname(const char* hostname)
@@ -302,6 +446,8 @@ void WiFiDrv::setHostname(const char* hostname)
                         
 int8_t WiFiDrv::disconnect()
 {
+	_networkDataValid = false;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(DISCONNECT_CMD, PARAM_NUMS_1);
@@ -369,11 +515,22 @@ uint8_t WiFiDrv::getConnectionStatus()
 
     SpiDrv::spiSlaveDeselect();
 
+    if (_data != _connectionStatus)
+    {
+        _connectionStatus = _data;
+        _networkDataValid = false;
+        if (_data == WL_CONNECTED)
+            _connectedSince = millis();
+    }
+
     return _data;
 }
 
 uint8_t* WiFiDrv::getMacAddress()
 {
+	if (_macValid)
+		return _mac;
+
 	WAIT_FOR_SLAVE_SELECT();
 
     // Send Command
@@ -394,27 +551,37 @@ uint8_t* WiFiDrv::getMacAddress()
     // Wait for reply
     uint8_t _dataLen = 0;
     SpiDrv::waitResponseCmd(GET_MACADDR_CMD, PARAM_NUMS_1, _mac, &_dataLen);
+    _macValid = (_dataLen == WL_MAC_ADDR_LENGTH);
 
     SpiDrv::spiSlaveDeselect();
 
     return _mac;
 }
 
+void WiFiDrv::updateNetworkData()
+{
+	if (!_networkDataValid)
+	{
+		getNetworkData(_localIp, _subnetMask, _gatewayIp);
+		_networkDataValid = true;
+	}
+}
+
 void WiFiDrv::getIpAddress(IPAddress& ip)
 {
-	getNetworkData(_localIp, _subnetMask, _gatewayIp);
+	updateNetworkData();
 	ip = _localIp;
 }
 
  void WiFiDrv::getSubnetMask(IPAddress& mask)
  {
-	getNetworkData(_localIp, _subnetMask, _gatewayIp);
+	updateNetworkData();
 	mask = _subnetMask;
  }
 
  void WiFiDrv::getGatewayIP(IPAddress& ip)
  {
-	getNetworkData(_localIp, _subnetMask, _gatewayIp);
+	updateNetworkData();
 	ip = _gatewayIp;
  }
 
@@ -534,6 +701,55 @@ uint8_t WiFiDrv::getCurrentEncryptionType()
     return encType;
 }
 
+uint8_t WiFiDrv::getLinkInfo(WiFiLinkInfo* info)
+{
+	uint8_t record[LINK_INFO_MAX_LEN];
+	tParam params[PARAM_NUMS_1] = { { LINK_INFO_MAX_LEN, (char*)record } };
+
+	WAIT_FOR_SLAVE_SELECT();
+
+    // Send Command
+    SpiDrv::sendCmd(GET_LINK_INFO_CMD, PARAM_NUMS_0);
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t numRead = 0;
+    if (!SpiDrv::waitResponseParams8(GET_LINK_INFO_CMD, &numRead, params, PARAM_NUMS_1))
+    {
+        WARN("error waitResponse");
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    memset(info, 0x00, sizeof(WiFiLinkInfo));
+    uint8_t len = params[0].paramLen;
+    if (numRead < PARAM_NUMS_1 || len < LINK_INFO_HEADER_LEN)
+    {
+        return 0;
+    }
+
+    uint32_t connectedTime;
+    memcpy(&connectedTime, &record[0], sizeof(connectedTime));
+    info->connectedTime = connectedTime;
+    memcpy(&info->rssi, &record[4], sizeof(info->rssi));
+    info->encryptionType = record[8];
+    memcpy(info->bssid, &record[9], WL_MAC_ADDR_LENGTH);
+    info->channel = record[15];
+    memcpy(info->ssid, &record[LINK_INFO_HEADER_LEN], len - LINK_INFO_HEADER_LEN);
+
+    return 1;
+}
+
+unsigned long WiFiDrv::getConnectedTime()
+{
+	if (_connectionStatus != WL_CONNECTED)
+		return 0;
+	return millis() - _connectedSince;
+}
+
 int8_t WiFiDrv::startScanNetworks()
 {
 	WAIT_FOR_SLAVE_SELECT();
@@ -562,6 +778,51 @@ int8_t WiFiDrv::startScanNetworks()
 }
 
 
+int8_t WiFiDrv::startScanNetworks(uint16_t channelMask, uint8_t passive, uint16_t dwellTime, const char* ssid)
+{
+	if (!hasCapability(CAP_SCAN_OPTIONS))
+		return startScanNetworks();
+
+	uint8_t ssidLen = (ssid != NULL) ? strlen(ssid) : 0;
+	if (ssidLen > WL_SSID_MAX_LENGTH)
+		ssidLen = WL_SSID_MAX_LENGTH;
+
+	WAIT_FOR_SLAVE_SELECT();
+
+    // Send Command
+    SpiDrv::sendCmd(START_SCAN_OPTIONS_CMD, PARAM_NUMS_4);
+    SpiDrv::sendParam(channelMask);
+    SpiDrv::sendParam(&passive, 1);
+    SpiDrv::sendParam(dwellTime);
+    SpiDrv::sendParam((uint8_t*)ssid, ssidLen, LAST_PARAM);
+
+    // pad to multiple of 4
+    int commandSize = 13 + ssidLen;
+    while (commandSize % 4) {
+        SpiDrv::readChar();
+        commandSize++;
+    }
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+
+    if (!SpiDrv::waitResponseCmd(START_SCAN_OPTIONS_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+     {
+         WARN("error waitResponse");
+         _data = WL_FAILURE;
+     }
+
+    SpiDrv::spiSlaveDeselect();
+
+    return ((int8_t)_data == WL_FAILURE)? _data : (int8_t)WL_SUCCESS;
+}
+
 uint8_t WiFiDrv::getScanNetworks()
 {
 	WAIT_FOR_SLAVE_SELECT();
@@ -591,6 +852,74 @@ const char* WiFiDrv::getSSIDNetoworks(uint8_t networkItem)
 	return _networkSsid[networkItem];
 }
 
+uint8_t WiFiDrv::getScanResults(uint8_t first, uint8_t count, WiFiScanResult* results)
+{
+	uint8_t records[WL_SCAN_RESULTS_BATCH][SCAN_RESULT_MAX_LEN];
+	tParam params[WL_SCAN_RESULTS_BATCH];
+	uint8_t numRead = 0;
+
+	while (numRead < count)
+	{
+		uint8_t index = first + numRead;
+		uint8_t batch = count - numRead;
+		if (batch > WL_SCAN_RESULTS_BATCH)
+		{
+			batch = WL_SCAN_RESULTS_BATCH;
+		}
+
+		for (uint8_t i = 0; i < batch; i++)
+		{
+			params[i].paramLen = SCAN_RESULT_MAX_LEN;
+			params[i].param = (char*)records[i];
+		}
+
+		WAIT_FOR_SLAVE_SELECT();
+
+		// Send Command
+		SpiDrv::sendCmd(GET_SCAN_RESULTS_CMD, PARAM_NUMS_2);
+		SpiDrv::sendParam(&index, 1);
+		SpiDrv::sendParam(&batch, 1, LAST_PARAM);
+
+		SpiDrv::spiSlaveDeselect();
+		//Wait the reply elaboration
+		SpiDrv::waitForSlaveReady();
+		SpiDrv::spiSlaveSelect();
+
+		// Wait for reply
+		uint8_t n = 0;
+		if (!SpiDrv::waitResponseParams8(GET_SCAN_RESULTS_CMD, &n, params, batch))
+		{
+			WARN("error waitResponse");
+		}
+		SpiDrv::spiSlaveDeselect();
+
+		for (uint8_t i = 0; i < n; i++)
+		{
+			WiFiScanResult* result = &results[numRead + i];
+			uint8_t len = params[i].paramLen;
+
+			memset(result, 0x00, sizeof(WiFiScanResult));
+			if (len < SCAN_RESULT_HEADER_LEN)
+			{
+				continue;
+			}
+			memcpy(&result->rssi, &records[i][0], sizeof(result->rssi));
+			result->encryptionType = records[i][4];
+			memcpy(result->bssid, &records[i][5], WL_MAC_ADDR_LENGTH);
+			result->channel = records[i][11];
+			memcpy(result->ssid, &records[i][SCAN_RESULT_HEADER_LEN], len - SCAN_RESULT_HEADER_LEN);
+		}
+		numRead += n;
+
+		if (n < batch)
+		{
+			break;
+		}
+	}
+
+	return numRead;
+}
+
 uint8_t WiFiDrv::getEncTypeNetowrks(uint8_t networkItem)
 {
 	if (networkItem >= WL_NETWORKS_LIST_MAXNUM)
@@ -776,7 +1105,7 @@ int WiFiDrv::getHostByName(IPAddress& aResult)
     return result;
 }
 
-int WiFiDrv::getHostByName(const char* aHostname, IPAddress& aResult)
+int WiFiDrv::resolveHostByName(const char* aHostname, IPAddress& aResult)
 {
 	if (reqHostByName(aHostname))
 	{
@@ -786,8 +1115,210 @@ int WiFiDrv::getHostByName(const char* aHostname, IPAddress& aResult)
 	}
 }
 
+tDnsCacheEntry* WiFiDrv::findDnsCacheEntry(const char* aHostname)
+{
+	unsigned long now = millis();
+
+	for (int i = 0; i < WL_DNS_CACHE_SIZE; i++)
+	{
+		tDnsCacheEntry* entry = &_dnsCache[i];
+
+		if (!entry->valid)
+			continue;
+
+		unsigned long ttl = entry->resolved ? _dnsCacheTtl : _dnsCacheNegativeTtl;
+		if ((now - entry->created) >= ttl)
+		{
+			// expired
+			entry->valid = 0;
+			continue;
+		}
+
+		if (strcasecmp(entry->hostname, aHostname) == 0)
+		{
+			entry->lastUsed = now;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+void WiFiDrv::storeDnsCacheEntry(const char* aHostname, int result, IPAddress& aResult)
+{
+	if (strlen(aHostname) > WL_DNS_CACHE_HOSTNAME_MAX)
+		return;
+	if ((result && _dnsCacheTtl == 0) || (!result && _dnsCacheNegativeTtl == 0))
+		return;
+
+	unsigned long now = millis();
+	tDnsCacheEntry* entry = NULL;
+
+	// reuse the entry of the same name, a free one, or the least recently used
+	for (int i = 0; i < WL_DNS_CACHE_SIZE; i++)
+	{
+		tDnsCacheEntry* candidate = &_dnsCache[i];
+
+		if (candidate->valid && strcasecmp(candidate->hostname, aHostname) == 0)
+		{
+			entry = candidate;
+			break;
+		}
+		if (entry == NULL || (entry->valid && !candidate->valid) ||
+			(entry->valid && (now - candidate->lastUsed) > (now - entry->lastUsed)))
+		{
+			entry = candidate;
+		}
+	}
+
+	strcpy(entry->hostname, aHostname);
+	for (int i = 0; i < WL_IPV4_LENGTH; i++)
+	{
+		entry->ip[i] = aResult[i];
+	}
+	entry->resolved = (result != 0);
+	entry->created = entry->lastUsed = now;
+	entry->valid = 1;
+}
+
+int WiFiDrv::getHostByName(const char* aHostname, IPAddress& aResult)
+{
+	tDnsCacheEntry* entry = findDnsCacheEntry(aHostname);
+
+	if (entry != NULL)
+	{
+		if (!entry->resolved)
+			return 0;
+
+		aResult = entry->ip;
+		return 1;
+	}
+
+	int result = resolveHostByName(aHostname, aResult);
+	storeDnsCacheEntry(aHostname, result, aResult);
+	return result;
+}
+
+int WiFiDrv::prefetchHostByName(const char* aHostname)
+{
+	IPAddress ip;
+
+	int result = resolveHostByName(aHostname, ip);
+	storeDnsCacheEntry(aHostname, result, ip);
+	return result;
+}
+
+void WiFiDrv::flushDnsCache(const char* aHostname)
+{
+	for (int i = 0; i < WL_DNS_CACHE_SIZE; i++)
+	{
+		if (aHostname == NULL || strcasecmp(_dnsCache[i].hostname, aHostname) == 0)
+		{
+			_dnsCache[i].valid = 0;
+		}
+	}
+}
+
+void WiFiDrv::setDnsCacheTtl(unsigned long ttl, unsigned long negativeTtl)
+{
+	_dnsCacheTtl = ttl;
+	_dnsCacheNegativeTtl = negativeTtl;
+	flushDnsCache();
+}
+
+void WiFiDrv::resolveDnsRequest(tDnsRequest* request)
+{
+	IPAddress ip;
+	int result = getHostByName(request->hostname, ip);
+	for (int i = 0; i < WL_IPV4_LENGTH; i++)
+	{
+		request->ip[i] = ip[i];
+	}
+	request->state = result ? DNS_REQ_RESOLVED : DNS_REQ_FAILED;
+}
+
+int8_t WiFiDrv::reqHostByNameAsync(const char* aHostname)
+{
+	for (int8_t i = 0; i < WL_DNS_QUEUE_SIZE; i++)
+	{
+		tDnsRequest* request = &_dnsQueue[i];
+
+		if (request->state != DNS_REQ_FREE)
+			continue;
+
+		request->hostname = aHostname;
+		request->gen = (request->gen + 1) & (0x7F >> WL_DNS_HANDLE_SLOT_BITS);
+
+		tDnsCacheEntry* entry = findDnsCacheEntry(aHostname);
+		if (entry != NULL)
+		{
+			memcpy(request->ip, entry->ip, WL_IPV4_LENGTH);
+			request->state = entry->resolved ? DNS_REQ_RESOLVED : DNS_REQ_FAILED;
+		} else {
+			request->state = DNS_REQ_QUEUED;
+		}
+		return (request->gen << WL_DNS_HANDLE_SLOT_BITS) | i;
+	}
+	return -1;
+}
+
+tDnsRequest* WiFiDrv::findDnsRequest(int8_t handle)
+{
+	if (handle < 0)
+		return NULL;
+
+	uint8_t slot = handle & WL_DNS_HANDLE_SLOT_MASK;
+	if (slot >= WL_DNS_QUEUE_SIZE)
+		return NULL;
+
+	tDnsRequest* request = &_dnsQueue[slot];
+	if (request->state == DNS_REQ_FREE || request->gen != (handle >> WL_DNS_HANDLE_SLOT_BITS))
+		return NULL;
+
+	return request;
+}
+
+int8_t WiFiDrv::getHostByNameAsync(int8_t handle, IPAddress& aResult)
+{
+	tDnsRequest* request = findDnsRequest(handle);
+	if (request == NULL)
+		return WL_RESOLVE_INVALID;
+
+	// resolve this lookup, the others wait for their own poll
+	if (request->state == DNS_REQ_QUEUED)
+	{
+		resolveDnsRequest(request);
+	}
+
+	switch (request->state)
+	{
+		case DNS_REQ_RESOLVED:
+			aResult = request->ip;
+			request->state = DNS_REQ_FREE;
+			return WL_RESOLVE_SUCCESS;
+
+		case DNS_REQ_FAILED:
+			request->state = DNS_REQ_FREE;
+			return WL_RESOLVE_FAILED;
+
+		default:
+			return WL_RESOLVE_IN_PROGRESS;
+	}
+}
+
+void WiFiDrv::cancelHostByNameAsync(int8_t handle)
+{
+	tDnsRequest* request = findDnsRequest(handle);
+	if (request != NULL)
+	{
+		request->state = DNS_REQ_FREE;
+	}
+}
+
 const char*  WiFiDrv::getFwVersion()
 {
+	if (_fwVersionValid)
+		return fwVersion;
+
 	WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(GET_FW_VERSION_CMD, PARAM_NUMS_0);
@@ -803,10 +1334,51 @@ const char*  WiFiDrv::getFwVersion()
     {
         WARN("error waitResponse");
     }
+    else
+    {
+        _fwVersionValid = (_dataLen != 0);
+    }
     SpiDrv::spiSlaveDeselect();
     return fwVersion;
 }
 
+uint32_t WiFiDrv::getCapabilities()
+{
+    if (_capabilitiesValid)
+    {
+        return _capabilities;
+    }
+
+    WAIT_FOR_SLAVE_SELECT();
+    // Send Command
+    SpiDrv::sendCmd(GET_CAPABILITIES_CMD, PARAM_NUMS_0);
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _dataLen = 0;
+    uint32_t _data = 0;
+    if (!SpiDrv::waitResponseCmd(GET_CAPABILITIES_CMD, PARAM_NUMS_1, (uint8_t*)&_data, &_dataLen))
+    {
+        // older firmware replies with an error, no extended commands
+        WARN("error waitResponse");
+        _data = 0;
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    _capabilities = _data;
+    _capabilitiesValid = true;
+    return _capabilities;
+}
+
+bool WiFiDrv::hasCapability(uint32_t capability)
+{
+    return (getCapabilities() & capability) == capability;
+}
+
 uint32_t WiFiDrv::getTime()
 {
     WAIT_FOR_SLAVE_SELECT();
@@ -855,8 +1427,46 @@ void WiFiDrv::setPowerMode(uint8_t mode)
     SpiDrv::spiSlaveDeselect();
 }
 
+int8_t WiFiDrv::setTlsSessionCache(uint8_t mode)
+{
+    if (!hasCapability(CAP_TLS_SESSION_CACHE))
+    {
+        return WL_FAILURE;
+    }
+
+    WAIT_FOR_SLAVE_SELECT();
+
+    // Send Command
+    SpiDrv::sendCmd(SET_TLS_SESSION_CACHE_CMD, PARAM_NUMS_1);
+
+    SpiDrv::sendParam(&mode, 1, LAST_PARAM);
+
+    // pad to multiple of 4
+    SpiDrv::readChar();
+    SpiDrv::readChar();
+
+    SpiDrv::spiSlaveDeselect();
+    //Wait the reply elaboration
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+
+    // Wait for reply
+    uint8_t _data = 0;
+    uint8_t _dataLen = 0;
+    if (!SpiDrv::waitResponseCmd(SET_TLS_SESSION_CACHE_CMD, PARAM_NUMS_1, &_data, &_dataLen))
+    {
+        WARN("error waitResponse");
+        _data = WL_FAILURE;
+    }
+    SpiDrv::spiSlaveDeselect();
+
+    return(_data == WIFI_SPI_ACK) ? WL_SUCCESS : WL_FAILURE;
+}
+
 int8_t WiFiDrv::wifiSetApNetwork(const char* ssid, uint8_t ssid_len, uint8_t channel)
 {
+	_networkDataValid = false;
+
     WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_AP_NET_CMD, PARAM_NUMS_2);
@@ -890,6 +1500,8 @@ int8_t WiFiDrv::wifiSetApNetwork(const char* ssid, uint8_t ssid_len, uint8_t cha
 
 int8_t WiFiDrv::wifiSetApPassphrase(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len, uint8_t channel)
 {
+	_networkDataValid = false;
+
     WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_AP_PASSPHRASE_CMD, PARAM_NUMS_3);
@@ -923,6 +1535,8 @@ int8_t WiFiDrv::wifiSetApPassphrase(const char* ssid, uint8_t ssid_len, const ch
 
 int8_t WiFiDrv::wifiSetEnterprise(uint8_t eapType, const char* ssid, uint8_t ssid_len, const char *username, const uint8_t username_len, const char *password, const uint8_t password_len, const char *identity, const uint8_t identity_len, const char* ca_cert, uint16_t ca_cert_len)
 {
+	_networkDataValid = false;
+
     WAIT_FOR_SLAVE_SELECT();
     // Send Command
     SpiDrv::sendCmd(SET_ENT_CMD, PARAM_NUMS_6);
@@ -27,6 +27,9 @@
 #include "WiFiUdp.h"
 #include "WiFiClient.h"
 
+struct WiFiScanResult;
+struct WiFiLinkInfo;
+
 // Key index length
 #define KEY_IDX_LEN     1
 // 100 msecs of delay to have the connection established
@@ -34,15 +37,39 @@
 // firmware version string length
 #define WL_FW_VER_LENGTH 6
 
+typedef struct
+{
+	char			hostname[WL_DNS_CACHE_HOSTNAME_MAX + 1];
+	uint8_t			ip[WL_IPV4_LENGTH];
+	uint8_t			valid;
+	uint8_t			resolved;
+	unsigned long	created;
+	unsigned long	lastUsed;
+} tDnsCacheEntry;
+
+enum eDnsRequestState {DNS_REQ_FREE, DNS_REQ_QUEUED, DNS_REQ_RESOLVED, DNS_REQ_FAILED};
+
+typedef struct
+{
+	const char*		hostname;
+	uint8_t			ip[WL_IPV4_LENGTH];
+	uint8_t			state;
+	uint8_t			gen;
+} tDnsRequest;
+
 class WiFiDrv
 {
 private:
 	// settings of requested network
-	static char 	_networkSsid[WL_NETWORKS_LIST_MAXNUM][WL_SSID_MAX_LENGTH];
+	static char 	_networkSsid[WL_NETWORKS_LIST_MAXNUM][WL_SSID_MAX_LENGTH + 1];
 
 	// firmware version string in the format a.b.c
 	static char 	fwVersion[WL_FW_VER_LENGTH];
 
+	// capability flags of the firmware, queried once
+	static uint32_t	_capabilities;
+	static bool	_capabilitiesValid;
+
 	// settings of current selected network
 	static char 	_ssid[WL_SSID_MAX_LENGTH];
 	static uint8_t 	_bssid[WL_MAC_ADDR_LENGTH];
@@ -50,21 +77,54 @@ private:
 	static uint8_t  _localIp[WL_IPV4_LENGTH];
 	static uint8_t  _subnetMask[WL_IPV4_LENGTH];
 	static uint8_t  _gatewayIp[WL_IPV4_LENGTH];
+	static bool     _networkDataValid;
+	static bool     _macValid;
+	static bool     _fwVersionValid;
+	static uint8_t  _connectionStatus;
+	static unsigned long _connectedSince;
+
+	// cache of resolved host names
+	static tDnsCacheEntry _dnsCache[WL_DNS_CACHE_SIZE];
+	static unsigned long _dnsCacheTtl;
+	static unsigned long _dnsCacheNegativeTtl;
+
+	// queue of asynchronous host name lookups
+	static tDnsRequest _dnsQueue[WL_DNS_QUEUE_SIZE];
 
 	/*
 	 * Get network Data information
 	 */
     static void getNetworkData(uint8_t *ip, uint8_t *mask, uint8_t *gwip);
 
+    /*
+     * Fetch the network data unless the cached values are still valid
+     */
+    static void updateNetworkData();
+
     static uint8_t reqHostByName(const char* aHostname);
 
     static int getHostByName(IPAddress& aResult);
 
+    static int resolveHostByName(const char* aHostname, IPAddress& aResult);
+
+    static tDnsCacheEntry* findDnsCacheEntry(const char* aHostname);
+
+    static void storeDnsCacheEntry(const char* aHostname, int result, IPAddress& aResult);
+
+    static void resolveDnsRequest(tDnsRequest* request);
+
+    static tDnsRequest* findDnsRequest(int8_t handle);
+
     /*
      * Get remote Data information on UDP socket
      */
     static void getRemoteData(uint8_t sock, uint8_t *ip, uint8_t *port);
 
+    /*
+     * Get the destination address of the current packet on UDP socket
+     */
+    static void getDestinationData(uint8_t sock, uint8_t *ip);
+
 public:
 
     /*
@@ -98,6 +158,32 @@ public:
      */
     static int8_t wifiSetPassphrase(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len);
 
+    /* Start Wifi connection to a specific access point, skipping the scan for the SSID.
+     * Firmware without CAP_BSSID_CONNECT connects to any access point of the SSID.
+     *
+     * param ssid: Pointer to the SSID string.
+     * param ssid_len: Lenght of ssid string.
+     * param passphrase: Passphrase, len 0 for an open network.
+     * param len: Lenght of passphrase string.
+     * param bssid: BSSID of the access point, in the order of getCurrentBSSID.
+     * param channel: Channel of the access point, 0 if unknown.
+     * return: WL_SUCCESS or WL_FAILURE
+     */
+    static int8_t wifiSetPassphraseBssid(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len,
+                                         const uint8_t* bssid, uint8_t channel);
+
+    /* Derive the pairwise master key of a WPA2 network on the module
+     * with DERIVE_PMK_CMD, a failure if the firmware has no CAP_DERIVE_PMK.
+     *
+     * param ssid: Pointer to the SSID string.
+     * param ssid_len: Lenght of ssid string.
+     * param passphrase: Passphrase.
+     * param len: Lenght of passphrase string.
+     * param pmk: buffer of WL_PMK_LENGTH bytes for the result
+     * return: WL_SUCCESS or WL_FAILURE
+     */
+    static int8_t getPmk(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len, uint8_t* pmk);
+
     /* Start Wifi connection with WEP encryption.
      * Configure a key into the device. The key type (WEP-40, WEP-104)
      * is determined by the size of the key (5 bytes for WEP-40, 13 bytes for WEP-104).
@@ -154,14 +240,15 @@ public:
     static uint8_t getConnectionStatus();
 
     /*
-     * Get the interface MAC address.
+     * Get the interface MAC address, queried once.
      *
      * return: pointer to uint8_t array with length WL_MAC_ADDR_LENGTH
      */
     static uint8_t* getMacAddress();
 
     /*
-     * Get the interface IP address.
+     * Get the interface IP address. IP address, subnet mask and gateway are
+     * cached until the connection status or the configuration changes.
      *
      * return: copy the ip address value in IPAddress object
      */
@@ -211,6 +298,24 @@ public:
      */
     static uint8_t getCurrentEncryptionType();
 
+    /*
+     * Get SSID, BSSID, RSSI, encryption type, channel and connected time of
+     * the current network with GET_LINK_INFO_CMD
+     *
+     * param info: record to fill
+     *
+     * return: 1 if the module reported the current network, 0 otherwise
+     */
+    static uint8_t getLinkInfo(WiFiLinkInfo* info);
+
+    /*
+     * Return the time since getConnectionStatus() first reported WL_CONNECTED
+     * for the current connection
+     *
+     * return: milliseconds, 0 if not connected
+     */
+    static unsigned long getConnectedTime();
+
     /*
      * Start scan WiFi networks available
      *
@@ -218,6 +323,19 @@ public:
      */
     static int8_t startScanNetworks();
 
+    /*
+     * Start scan WiFi networks available with START_SCAN_OPTIONS_CMD.
+     * Firmware without CAP_SCAN_OPTIONS runs a full scan instead.
+     *
+     * param channelMask: channels to scan, see WL_SCAN_CHANNEL
+     * param passive: listen for beacons instead of sending probe requests
+     * param dwellTime: time spent on each channel in ms, 0 for the firmware default
+     * param ssid: report only this network, NULL for all
+     *
+     * return: WL_SUCCESS or WL_FAILURE
+     */
+    static int8_t startScanNetworks(uint16_t channelMask, uint8_t passive, uint16_t dwellTime, const char* ssid);
+
     /*
      * Get the networks available
      *
@@ -256,6 +374,18 @@ public:
 
     static uint8_t getChannelNetowrks(uint8_t networkItem);
 
+    /*
+     * Get the full records of the networks discovered during the network scan
+     * with GET_SCAN_RESULTS_CMD, in transfers of WL_SCAN_RESULTS_BATCH records
+     *
+     * param first: index of the first network item
+     * param count: number of records to get
+     * param results: array of at least count records
+     *
+     * return: number of records stored in results
+     */
+    static uint8_t getScanResults(uint8_t first, uint8_t count, WiFiScanResult* results);
+
     /*
      * Resolve the given hostname to an IP address.
      * param aHostname: Name to be resolved
@@ -265,16 +395,74 @@ public:
      */
     static int getHostByName(const char* aHostname, IPAddress& aResult);
 
+    /*
+     * Resolve the given hostname bypassing the cache and store the result.
+     * param aHostname: Name to be resolved
+     * result: 1 if the name was resolved, else 0
+     */
+    static int prefetchHostByName(const char* aHostname);
+
+    /*
+     * Remove entries from the host name cache.
+     * param aHostname: Name to remove, NULL to flush the whole cache
+     */
+    static void flushDnsCache(const char* aHostname = NULL);
+
+    /*
+     * Set the time to live of the host name cache entries.
+     * param ttl: msecs a resolved name is kept, 0 disables the cache
+     * param negativeTtl: msecs a failed lookup is kept, 0 disables negative caching
+     */
+    static void setDnsCacheTtl(unsigned long ttl, unsigned long negativeTtl);
+
+    /*
+     * Queue the resolution of the given hostname.
+     * Names found in the cache complete immediately, the others are
+     * resolved by the first getHostByNameAsync() call for their handle,
+     * which runs a complete, blocking getHostByName().
+     * param aHostname: Name to be resolved, must stay valid until the lookup completes
+     * result: handle of the lookup, or -1 if the queue is full
+     */
+    static int8_t reqHostByNameAsync(const char* aHostname);
+
+    /*
+     * Check the result of a lookup started with reqHostByNameAsync().
+     * The handle is released once a final result is returned.
+     * param handle: handle of the lookup
+     * param aResult: IPAddress structure to store the returned IP address
+     * result: one value of wl_resolve_result_t enum
+     */
+    static int8_t getHostByNameAsync(int8_t handle, IPAddress& aResult);
+
+    static void cancelHostByNameAsync(int8_t handle);
+
     /*
      * Get the firmware version
      * result: version as string with this format a.b.c
      */
     static const char* getFwVersion();
 
+    /*
+     * Get the extended capabilities of the firmware.
+     * Firmware that does not know GET_CAPABILITIES_CMD reports none.
+     * result: bitmask of CAP_* flags
+     */
+    static uint32_t getCapabilities();
+
+    static bool hasCapability(uint32_t capability);
+
     static uint32_t getTime();
 
     static void setPowerMode(uint8_t mode);
 
+    /*
+     * Control the TLS session cache of the module, used to resume
+     * sessions on reconnects to the same host.
+     * param mode: one of TLS_SESSION_CACHE_DISABLE, _ENABLE or _CLEAR
+     * return: WL_SUCCESS or WL_FAILURE, also if the firmware has no CAP_TLS_SESSION_CACHE
+     */
+    static int8_t setTlsSessionCache(uint8_t mode);
+
     static int8_t wifiSetApNetwork(const char* ssid, uint8_t ssid_len, uint8_t channel);
     static int8_t wifiSetApPassphrase(const char* ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len, uint8_t channel);
     static int8_t wifiSetEnterprise(uint8_t eapType,
@@ -0,0 +1,202 @@
+/*
+  This file is part of the WiFiNINA library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+
+#include "utility/wifi_pmk.h"
+
+#define SHA1_BLOCK_LENGTH 64
+#define SHA1_DIGEST_LENGTH 20
+#define PMK_ITERATIONS 4096
+
+typedef struct {
+  uint32_t state[5];
+  uint8_t buffer[SHA1_BLOCK_LENGTH];
+  uint32_t length;
+} tSha1;
+
+static uint32_t rol(uint32_t value, uint8_t bits)
+{
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1Transform(tSha1* sha)
+{
+  uint32_t w[16];
+  uint32_t a = sha->state[0];
+  uint32_t b = sha->state[1];
+  uint32_t c = sha->state[2];
+  uint32_t d = sha->state[3];
+  uint32_t e = sha->state[4];
+
+  for (uint8_t i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)sha->buffer[i * 4] << 24) | ((uint32_t)sha->buffer[i * 4 + 1] << 16) |
+           ((uint32_t)sha->buffer[i * 4 + 2] << 8) | sha->buffer[i * 4 + 3];
+  }
+
+  for (uint8_t i = 0; i < 80; i++) {
+    uint32_t f, k;
+
+    if (i >= 16) {
+      // the message schedule is kept in a ring of 16 words
+      w[i & 15] = rol(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+    }
+
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    } else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    } else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+
+    uint32_t temp = rol(a, 5) + f + e + k + w[i & 15];
+    e = d;
+    d = c;
+    c = rol(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  sha->state[0] += a;
+  sha->state[1] += b;
+  sha->state[2] += c;
+  sha->state[3] += d;
+  sha->state[4] += e;
+}
+
+static void sha1Init(tSha1* sha)
+{
+  sha->state[0] = 0x67452301;
+  sha->state[1] = 0xEFCDAB89;
+  sha->state[2] = 0x98BADCFE;
+  sha->state[3] = 0x10325476;
+  sha->state[4] = 0xC3D2E1F0;
+  sha->length = 0;
+}
+
+static void sha1Update(tSha1* sha, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    sha->buffer[sha->length++ % SHA1_BLOCK_LENGTH] = *data++;
+
+    if ((sha->length % SHA1_BLOCK_LENGTH) == 0) {
+      sha1Transform(sha);
+    }
+  }
+}
+
+static void sha1Final(tSha1* sha, uint8_t* digest)
+{
+  uint32_t bits = sha->length * 8;
+  uint8_t pad = 0x80;
+
+  sha1Update(sha, &pad, 1);
+  pad = 0x00;
+  while ((sha->length % SHA1_BLOCK_LENGTH) != (SHA1_BLOCK_LENGTH - 8)) {
+    sha1Update(sha, &pad, 1);
+  }
+
+  // message length in bits, big-endian, the upper word is always 0 here
+  uint8_t length[8] = { 0, 0, 0, 0, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits };
+  sha1Update(sha, length, sizeof(length));
+
+  for (uint8_t i = 0; i < SHA1_DIGEST_LENGTH; i++) {
+    digest[i] = sha->state[i / 4] >> (24 - (i % 4) * 8);
+  }
+}
+
+// HMAC of a message with the inner and outer hashes already keyed
+static void hmacSha1(const tSha1* inner, const tSha1* outer, const uint8_t* data, size_t len, uint8_t* digest)
+{
+  tSha1 sha;
+
+  sha = *inner;
+  sha1Update(&sha, data, len);
+  sha1Final(&sha, digest);
+
+  sha = *outer;
+  sha1Update(&sha, digest, SHA1_DIGEST_LENGTH);
+  sha1Final(&sha, digest);
+}
+
+void wifiDerivePmk(const char* ssid, uint8_t ssid_len, const char* passphrase, uint8_t len, uint8_t* pmk)
+{
+  uint8_t key[SHA1_BLOCK_LENGTH];
+  tSha1 inner;
+  tSha1 outer;
+
+  memset(key, 0x00, sizeof(key));
+  if (len > SHA1_BLOCK_LENGTH) {
+    sha1Init(&inner);
+    sha1Update(&inner, (const uint8_t*)passphrase, len);
+    sha1Final(&inner, key);
+  } else {
+    memcpy(key, passphrase, len);
+  }
+
+  // key the inner and outer hashes once for all the iterations
+  sha1Init(&inner);
+  sha1Init(&outer);
+  for (uint8_t i = 0; i < SHA1_BLOCK_LENGTH; i++) {
+    uint8_t ipad = key[i] ^ 0x36;
+    uint8_t opad = key[i] ^ 0x5c;
+
+    sha1Update(&inner, &ipad, 1);
+    sha1Update(&outer, &opad, 1);
+  }
+
+  for (uint8_t block = 1; block * SHA1_DIGEST_LENGTH < WL_PMK_LENGTH + SHA1_DIGEST_LENGTH; block++) {
+    uint8_t u[SHA1_DIGEST_LENGTH];
+    uint8_t t[SHA1_DIGEST_LENGTH];
+    uint8_t index[4] = { 0, 0, 0, block };
+    tSha1 sha;
+
+    // U1 = HMAC(passphrase, ssid || INT(block))
+    sha = inner;
+    sha1Update(&sha, (const uint8_t*)ssid, ssid_len);
+    sha1Update(&sha, index, sizeof(index));
+    sha1Final(&sha, u);
+    sha = outer;
+    sha1Update(&sha, u, SHA1_DIGEST_LENGTH);
+    sha1Final(&sha, u);
+    memcpy(t, u, SHA1_DIGEST_LENGTH);
+
+    for (uint16_t i = 1; i < PMK_ITERATIONS; i++) {
+      hmacSha1(&inner, &outer, u, SHA1_DIGEST_LENGTH, u);
+
+      for (uint8_t j = 0; j < SHA1_DIGEST_LENGTH; j++) {
+        t[j] ^= u[j];
+      }
+    }
+
+    uint8_t offset = (block - 1) * SHA1_DIGEST_LENGTH;
+    uint8_t size = WL_PMK_LENGTH - offset;
+    if (size > SHA1_DIGEST_LENGTH) {
+      size = SHA1_DIGEST_LENGTH;
+    }
+    memcpy(pmk + offset, t, size);
+  }
+}
@@ -0,0 +1,41 @@
+/*
+  This file is part of the WiFiNINA library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef WiFiPmk_h
+#define WiFiPmk_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Length of a WPA2 pairwise master key
+#define WL_PMK_LENGTH 32
+
+/*
+ * Derive the WPA2 pairwise master key of a network on the host,
+ * PBKDF2-HMAC-SHA1 with 4096 iterations as defined by IEEE 802.11i.
+ *
+ * param ssid: SSID of the network, the salt
+ * param ssid_len: length of ssid
+ * param passphrase: passphrase of the network
+ * param len: length of passphrase
+ * param pmk: buffer of WL_PMK_LENGTH bytes for the result
+ */
+void wifiDerivePmk(const char* ssid, uint8_t ssid_len, const char* passphrase, uint8_t len, uint8_t* pmk);
+
+#endif
@@ -97,13 +97,80 @@ enum {
 	SEND_DATA_TCP_CMD		= 0x44,
     GET_DATABUF_TCP_CMD		= 0x45,
     INSERT_DATABUF_CMD		= 0x46,
+    SEND_DATA_MULTI_TCP_CMD	= 0x47,
+    SEND_DATABUF_UDP_CMD	= 0x48,
+    GET_DATAGRAMS_UDP_CMD	= 0x49,
+    SEND_DATAGRAMS_UDP_CMD	= 0x4A,
 
     // regular format commands
     SET_PIN_MODE		= 0x50,
     SET_DIGITAL_WRITE	= 0x51,
     SET_ANALOG_WRITE	= 0x52,
+
+    // extended regular format commands, check GET_CAPABILITIES_CMD before use
+    GET_CAPABILITIES_CMD	= 0x70,
+    ABORT_CLIENT_TCP_CMD	= 0x71,
+    SET_TLS_SESSION_CACHE_CMD	= 0x72,
+    GET_SOCKETS_READY_CMD	= 0x73,
+    DISCARD_DATA_CMD		= 0x74,
+    SET_UDP_GROUP_CMD		= 0x75,
+    GET_DEST_DATA_CMD		= 0x76,
+    GET_SCAN_RESULTS_CMD	= 0x77,
+    START_SCAN_OPTIONS_CMD	= 0x78,
+    SET_PASSPHRASE_BSSID_CMD	= 0x79,
+    DERIVE_PMK_CMD		= 0x7A,
+    GET_LINK_INFO_CMD		= 0x7B,
+    START_CLIENT_ASYNC_CMD	= 0x7C,
+    ACCEPT_CLIENT_TCP_CMD	= 0x7D,
+};
+
+// capability flags reported by GET_CAPABILITIES_CMD
+enum {
+	CAP_ABORT_CLIENT	= 0x00000001,
+	CAP_TLS_SESSION_CACHE	= 0x00000002,
+	CAP_SEND_DATA_MULTI	= 0x00000004,
+	CAP_SOCKETS_READY	= 0x00000008,
+	CAP_SEND_DATABUF_UDP	= 0x00000010,
+	CAP_DISCARD_DATA	= 0x00000020,
+	CAP_GET_DATAGRAMS_UDP	= 0x00000040,
+	CAP_SEND_DATAGRAMS_UDP	= 0x00000080,
+	CAP_UDP_GROUPS		= 0x00000100,
+	CAP_SCAN_RESULTS	= 0x00000200,
+	CAP_SCAN_OPTIONS	= 0x00000400,
+	CAP_BSSID_CONNECT	= 0x00000800,
+	CAP_DERIVE_PMK		= 0x00001000,
+	CAP_LINK_INFO		= 0x00002000,
+	CAP_CONNECT_ASYNC	= 0x00004000,
+	CAP_ACCEPT_CLIENT	= 0x00008000,
+};
+
+// actions of SET_UDP_GROUP_CMD
+enum {
+	UDP_GROUP_LEAVE	= 0,
+	UDP_GROUP_JOIN	= 1,
 };
 
+// modes of SET_TLS_SESSION_CACHE_CMD
+enum {
+	TLS_SESSION_CACHE_DISABLE	= 0,
+	TLS_SESSION_CACHE_ENABLE	= 1,
+	TLS_SESSION_CACHE_CLEAR		= 2,
+};
+
+
+// datagram header of GET_DATAGRAMS_UDP_CMD and SEND_DATAGRAMS_UDP_CMD:
+// IPv4 address and port, big-endian
+#define DATAGRAM_HEADER_LEN	6
+
+// record of GET_SCAN_RESULTS_CMD: RSSI (int32), encryption type, BSSID,
+// channel, followed by the SSID without terminator
+#define SCAN_RESULT_HEADER_LEN	12
+#define SCAN_RESULT_MAX_LEN	(SCAN_RESULT_HEADER_LEN + WL_SSID_MAX_LENGTH)
+
+// record of GET_LINK_INFO_CMD: milliseconds since the association (uint32),
+// followed by the current network in the layout of a scan result record
+#define LINK_INFO_HEADER_LEN	(4 + SCAN_RESULT_HEADER_LEN)
+#define LINK_INFO_MAX_LEN	(LINK_INFO_HEADER_LEN + WL_SSID_MAX_LENGTH)
 
 enum wl_tcp_state {
   CLOSED      = 0,
@@ -30,6 +30,7 @@
 // Maximum size of a SSID
 #define WL_SSID_MAX_LENGTH 32
 // Length of passphrase. Valid lengths are 8-63.
+#define WL_WPA_KEY_MIN_LENGTH 8
 #define WL_WPA_KEY_MAX_LENGTH 63
 // Length of key in bytes. Valid values are 5 and 13.
 #define WL_WEP_KEY_MAX_LENGTH 13
@@ -38,13 +39,54 @@
 // Size of a MAC-address or BSSID
 #define WL_IPV4_LENGTH 4
 // Maximum size of a SSID list
+#ifndef WL_NETWORKS_LIST_MAXNUM
 #define WL_NETWORKS_LIST_MAXNUM	10
+#endif
+// Channel mask of a scan, bit n - 1 selects channel n
+#define WL_SCAN_ALL_CHANNELS	0x3FFF
+#define WL_SCAN_CHANNEL(ch)	(1 << ((ch) - 1))
 // Maxmium number of socket
 #define	WIFI_MAX_SOCK_NUM	10
 // Socket not available constant
 #define SOCK_NOT_AVAIL  255
 // Default state value for Wifi state field
 #define NA_STATE -1
+// Number of entries of the host name cache
+#ifndef WL_DNS_CACHE_SIZE
+#ifdef __AVR__
+#define WL_DNS_CACHE_SIZE 2
+#else
+#define WL_DNS_CACHE_SIZE 4
+#endif
+#endif
+// Longest host name that can be cached
+#define WL_DNS_CACHE_HOSTNAME_MAX 64
+// Default time to live of resolved and failed cache entries, in msecs
+#define WL_DNS_CACHE_DEF_TTL 60000
+#define WL_DNS_CACHE_DEF_NEG_TTL 5000
+// Number of host name lookups that can be queued
+#ifndef WL_DNS_QUEUE_SIZE
+#ifdef __AVR__
+#define WL_DNS_QUEUE_SIZE 2
+#else
+#define WL_DNS_QUEUE_SIZE 5
+#endif
+#endif
+// Bits of a lookup handle holding the queue slot, the others hold the
+// generation of the slot so stale handles are rejected
+#define WL_DNS_HANDLE_SLOT_BITS 3
+#define WL_DNS_HANDLE_SLOT_MASK ((1 << WL_DNS_HANDLE_SLOT_BITS) - 1)
+#if WL_DNS_QUEUE_SIZE > (1 << WL_DNS_HANDLE_SLOT_BITS)
+#error "WL_DNS_QUEUE_SIZE is too large"
+#endif
+// Number of scan results fetched by one GET_SCAN_RESULTS_CMD
+#ifndef WL_SCAN_RESULTS_BATCH
+#ifdef __AVR__
+#define WL_SCAN_RESULTS_BATCH 4
+#else
+#define WL_SCAN_RESULTS_BATCH 10
+#endif
+#endif
 
 typedef enum {
 	WL_NO_SHIELD = 255,
@@ -54,4 +54,11 @@ typedef enum {
   WL_PING_ERROR = -4
 } wl_ping_result_t;
 
+typedef enum {
+  WL_RESOLVE_SUCCESS = 1,
+  WL_RESOLVE_IN_PROGRESS = 0,
+  WL_RESOLVE_FAILED = -1,
+  WL_RESOLVE_INVALID = -2
+} wl_resolve_result_t;
+
 #endif //_WL_TYPES_H_